@@ -0,0 +1,357 @@
+#include "async_client.h"
+#include "connection.h"
+#include "socket_options.h"
+#include "resolver.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#define MAX_EVENTS 64
+
+AsyncClient::AsyncClient(const std::string& host, int port, size_t max_connections)
+    : host(host), port(port), max_connections(max_connections) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        loop_error = NET_IO_ERROR; // Every request fails with it
+    }
+}
+
+AsyncClient::~AsyncClient() {
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+void AsyncClient::submit(HttpRequest request, ResponseCallback callback) {
+    queue.push_back({std::move(request), std::move(callback)});
+    dispatch();
+}
+
+void AsyncClient::submit(std::string request_str, ResponseCallback callback) {
+    HttpRequest request;
+    request.head = std::move(request_str);
+    submit(std::move(request), std::move(callback));
+}
+
+// Hands queued requests to idle connections, then opens new ones
+void AsyncClient::dispatch() {
+    if (loop_error != NET_OK) {
+        fail_queued(loop_error);
+        return;
+    }
+    for (auto& entry : connections) {
+        if (queue.empty()) return;
+        Connection& conn = *entry.second;
+        if (conn.state == IDLE) {
+            conn.current = std::move(queue.front());
+            queue.pop_front();
+            in_flight++;
+            start_request(conn);
+            return dispatch(); // start_request may have dropped connections
+        }
+    }
+    while (!queue.empty() && connections.size() < max_connections) {
+        NetError error = open_async_connection();
+        if (error != NET_OK) {
+            PendingRequest failed = std::move(queue.front());
+            queue.pop_front();
+            HttpResponse response;
+            response.net_error = error;
+            failed.callback(response);
+        }
+    }
+}
+
+// Fails every queued request (callbacks may queue more, which fail too)
+void AsyncClient::fail_queued(NetError error) {
+    while (!queue.empty()) {
+        PendingRequest failed = std::move(queue.front());
+        queue.pop_front();
+        HttpResponse response;
+        response.net_error = error;
+        failed.callback(response);
+    }
+}
+
+NetError AsyncClient::open_async_connection() {
+    // Cached after the first connection; the preferred address is used
+    // (connects here aren't raced, a failed one fails its request)
+    std::vector<ResolvedAddress> addresses;
+    NetError error = NET_OK;
+    if (!resolve_host(host, port, addresses, &error)) {
+        return error;
+    }
+    const ResolvedAddress& address = addresses[0];
+
+    int sockfd = socket(address.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0) {
+        return NET_IO_ERROR;
+    }
+    apply_socket_profile(sockfd, get_socket_profile());
+    bool connected = connect(sockfd, (const struct sockaddr*)&address.addr, address.addr_len) == 0;
+    if (!connected && errno != EINPROGRESS) {
+        close(sockfd);
+        return NET_CONNECT_FAILED;
+    }
+
+    std::unique_ptr<Connection> conn(new Connection());
+    conn->sockfd = sockfd;
+    conn->generation = next_generation++;
+    conn->deadline = deadline_after(get_net_timeouts().connect_ms);
+
+    // Registered once for both directions; edge-triggered, so every handler
+    // works until EAGAIN
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = ((uint64_t)conn->generation << 32) | (uint32_t)sockfd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockfd, &event) < 0) {
+        close(sockfd);
+        return NET_IO_ERROR;
+    }
+
+    Connection& added = *conn;
+    connections[sockfd] = std::move(conn);
+    added.current = std::move(queue.front());
+    queue.pop_front();
+    in_flight++;
+    if (connected) {
+        start_request(added);
+    }
+    return NET_OK;
+}
+
+void AsyncClient::start_request(Connection& conn) {
+    conn.state = WRITING;
+    conn.written = 0;
+    conn.deadline = deadline_after(get_net_timeouts().write_ms);
+    NetError error = write_request(conn);
+    if (error != NET_OK) {
+        fail(conn, error);
+    }
+}
+
+int AsyncClient::poll_once(int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    if (loop_error != NET_OK) {
+        return 0;
+    }
+    int count = epoll_wait(epoll_fd, events, MAX_EVENTS, wait_timeout(timeout_ms));
+    if (count < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        // The loop can't make progress any more: fail what is pending
+        // instead of leaving run() waiting forever
+        loop_error = NET_IO_ERROR;
+        while (!connections.empty()) {
+            Connection& conn = *connections.begin()->second;
+            if (conn.state == IDLE) {
+                drop(conn);
+            } else {
+                fail(conn, loop_error);
+            }
+        }
+        fail_queued(loop_error);
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int sockfd = (int)(uint32_t)events[i].data.u64;
+        uint32_t generation = events[i].data.u64 >> 32;
+        auto found = connections.find(sockfd);
+        if (found == connections.end() || found->second->generation != generation) {
+            continue; // The connection was closed earlier in this batch
+        }
+        handle_event(*found->second, events[i].events);
+    }
+    expire_connections();
+    return count;
+}
+
+// timeout_ms, shortened to the nearest connection deadline
+int AsyncClient::wait_timeout(int timeout_ms) const {
+    for (const auto& entry : connections) {
+        const Connection& conn = *entry.second;
+        if (conn.state == IDLE) continue;
+        int left_ms = remaining_ms(conn.deadline);
+        if (left_ms >= 0 && (timeout_ms < 0 || left_ms < timeout_ms)) {
+            timeout_ms = left_ms;
+        }
+    }
+    return timeout_ms;
+}
+
+// Fails the requests whose current step ran past its deadline
+void AsyncClient::expire_connections() {
+    std::vector<int> expired;
+    for (const auto& entry : connections) {
+        const Connection& conn = *entry.second;
+        if (conn.state != IDLE && remaining_ms(conn.deadline) == 0) {
+            expired.push_back(entry.first);
+        }
+    }
+    for (int sockfd : expired) {
+        auto found = connections.find(sockfd);
+        if (found == connections.end()) continue; // Dropped by an earlier failure's callback
+        Connection& conn = *found->second;
+        if (conn.state == IDLE || remaining_ms(conn.deadline) != 0) continue; // Reused meanwhile
+        fail(conn, conn.state == CONNECTING ? NET_CONNECT_TIMEOUT
+                 : conn.state == WRITING ? NET_WRITE_TIMEOUT : NET_READ_TIMEOUT);
+    }
+}
+
+void AsyncClient::run() {
+    while (pending() > 0) {
+        poll_once(-1);
+    }
+}
+
+void AsyncClient::handle_event(Connection& conn, uint32_t events) {
+    switch (conn.state) {
+    case CONNECTING:
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(conn.sockfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0
+                || !(events & EPOLLOUT)) {
+                fail(conn, NET_CONNECT_FAILED);
+                return;
+            }
+            start_request(conn);
+        }
+        break;
+    case WRITING:
+    case READING: {
+        NetError error = conn.state == WRITING ? write_request(conn) : read_response(conn);
+        if (error != NET_OK) {
+            fail(conn, error);
+        }
+        break;
+    }
+    case IDLE:
+        // Only a close by the server ends an idle connection; readiness
+        // alone (e.g. EPOLLOUT after the last write) doesn't
+        if ((events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) || ((events & EPOLLIN) && !is_connection_alive(conn.sockfd))) {
+            drop(conn);
+        }
+        break;
+    }
+}
+
+NetError AsyncClient::write_request(Connection& conn) {
+    const std::string& head = conn.current.request.head;
+    const std::string& body = conn.current.request.body;
+    size_t total = head.size() + body.size();
+
+    while (conn.written < total) {
+        struct iovec iov[2];
+        int iov_count = 0;
+        if (conn.written < head.size()) {
+            iov[iov_count].iov_base = (void*)(head.data() + conn.written);
+            iov[iov_count].iov_len = head.size() - conn.written;
+            iov_count++;
+        }
+        size_t body_offset = conn.written > head.size() ? conn.written - head.size() : 0;
+        if (body_offset < body.size()) {
+            iov[iov_count].iov_base = (void*)(body.data() + body_offset);
+            iov[iov_count].iov_len = body.size() - body_offset;
+            iov_count++;
+        }
+
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        ssize_t bytes = sendmsg(conn.sockfd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            // EINPROGRESS: TCP Fast Open handshake still running
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS) return NET_OK; // Wait for EPOLLOUT
+            return errno == EPIPE || errno == ECONNRESET ? NET_CONNECTION_CLOSED : NET_IO_ERROR;
+        }
+        conn.written += bytes;
+    }
+
+    conn.state = READING;
+    conn.deadline = deadline_after(get_net_timeouts().read_ms);
+    return read_response(conn); // The reply may already be there
+}
+
+NetError AsyncClient::read_response(Connection& conn) {
+    char buffer[BUFLEN];
+    while (true) {
+        rearm_quickack(conn.sockfd);
+        ssize_t bytes = read(conn.sockfd, buffer, BUFLEN);
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return NET_OK; // Wait for EPOLLIN
+            return errno == ECONNRESET ? NET_CONNECTION_CLOSED : NET_IO_ERROR;
+        }
+        if (bytes == 0) {
+            conn.parser.finish(); // Completes a body delimited by the connection close
+            if (!conn.parser.done()) {
+                return NET_CONNECTION_CLOSED;
+            }
+            HttpResponse response = conn.parser.take_response();
+            response.keep_alive = false;
+            complete(conn, response);
+            return NET_OK;
+        }
+
+        conn.parser.feed(buffer, bytes);
+        if (conn.parser.failed()) {
+            return NET_BAD_RESPONSE;
+        }
+        if (conn.parser.done()) {
+            HttpResponse response = conn.parser.take_response();
+            complete(conn, response);
+            return NET_OK;
+        }
+    }
+}
+
+void AsyncClient::complete(Connection& conn, HttpResponse& response) {
+    PendingRequest finished = std::move(conn.current);
+    in_flight--;
+    if (response.keep_alive) {
+        conn.state = IDLE;
+        conn.reused = true;
+    } else {
+        drop(conn);
+    }
+
+    finished.callback(response); // May submit more requests
+    dispatch();
+}
+
+void AsyncClient::fail(Connection& conn, NetError error) {
+    PendingRequest failed = std::move(conn.current);
+    bool retry = error == NET_CONNECTION_CLOSED && conn.reused && !failed.retried
+                 && is_idempotent_request(failed.request.head);
+    in_flight--;
+    drop(conn);
+
+    if (retry) {
+        // Probably a keep-alive connection the server had just closed
+        failed.retried = true;
+        queue.push_front(std::move(failed));
+    } else {
+        HttpResponse response;
+        response.net_error = error;
+        failed.callback(response);
+    }
+    dispatch();
+}
+
+void AsyncClient::drop(Connection& conn) {
+    int sockfd = conn.sockfd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sockfd, nullptr);
+    close(sockfd);
+    connections.erase(sockfd); // Destroys conn
+}
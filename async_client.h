@@ -0,0 +1,88 @@
+#ifndef ASYNC_CLIENT_H
+#define ASYNC_CLIENT_H
+
+#include <string>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "http_requests.h"
+#include "http_parser.h"
+
+// Called once a request completes; status_code is 0 (and net_error set) if it failed
+typedef std::function<void(HttpResponse& response)> ResponseCallback;
+
+// Non-blocking HTTP client driven by an edge-triggered epoll loop. Queued
+// requests are spread over up to max_connections keep-alive connections to
+// the same server, each with its own connect -> write -> read state
+// machine, so many requests can be in flight from a single thread. The
+// connect/write/read timeouts from get_net_timeouts() apply to each
+// connection's current step.
+class AsyncClient {
+public:
+    AsyncClient(const std::string& host, int port, size_t max_connections = 64);
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    // Queues a request; the callback runs from inside poll_once()/run()
+    void submit(HttpRequest request, ResponseCallback callback);
+    void submit(std::string request_str, ResponseCallback callback);
+
+    // Waits up to timeout_ms (-1: forever) for socket events and handles them.
+    // Returns the number of events processed.
+    int poll_once(int timeout_ms);
+
+    // Drives the loop until every submitted request has completed
+    void run();
+
+    // Requests queued or in flight
+    size_t pending() const { return queue.size() + in_flight; }
+
+private:
+    struct PendingRequest {
+        HttpRequest request;
+        ResponseCallback callback;
+        bool retried = false;
+    };
+
+    enum ConnectionState { CONNECTING, IDLE, WRITING, READING };
+
+    struct Connection {
+        int sockfd;
+        uint32_t generation;     // Tells stale epoll events for a reused fd apart
+        ConnectionState state = CONNECTING;
+        bool reused = false;     // Already completed a request before this one
+        PendingRequest current;
+        size_t written = 0;      // Bytes of head + body sent so far
+        Deadline deadline = Deadline::max(); // For the current step
+        ResponseParser parser;
+    };
+
+    std::string host;
+    int port;
+    size_t max_connections;
+    int epoll_fd;
+    NetError loop_error = NET_OK; // Set if epoll itself failed; fails every request
+    uint32_t next_generation = 1;
+    size_t in_flight = 0;
+    std::deque<PendingRequest> queue;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+
+    void dispatch();
+    NetError open_async_connection();
+    void start_request(Connection& conn);
+    void handle_event(Connection& conn, uint32_t events);
+    NetError write_request(Connection& conn);
+    NetError read_response(Connection& conn);
+    void complete(Connection& conn, HttpResponse& response);
+    void fail(Connection& conn, NetError error);
+    void fail_queued(NetError error);
+    int wait_timeout(int timeout_ms) const;
+    void expire_connections();
+    void drop(Connection& conn);
+};
+
+#endif // ASYNC_CLIENT_H
@@ -0,0 +1,35 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+// Average nanoseconds per call of op() over iterations calls. op returns a
+// size that is summed, so the compiler can't drop the work.
+template <typename Op>
+double time_per_op(Op op, int iterations) {
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += op();
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (sink == 1) std::printf(" ");
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// Best of a few runs, which is less sensitive to a busy machine
+#define BENCH_RUNS 5
+
+template <typename Op>
+double best_time_per_op(Op op, int iterations) {
+    double best = time_per_op(op, iterations);
+    for (int run = 1; run < BENCH_RUNS; run++) {
+        double time = time_per_op(op, iterations);
+        if (time < best) best = time;
+    }
+    return best;
+}
+
+#endif // BENCH_H
@@ -0,0 +1,139 @@
+// DelimiterScanner (header_scan.h) with each instruction set the CPU has,
+// against the memchr per line + find(':') loop the parser used before it,
+// over realistic header blocks; then ResponseParser::feed of whole
+// responses per instruction set. Every scan is checked against the old
+// loop first. The numbers pick the default in best_isa() (header_scan.cpp).
+// Run: make bench && bench/header_scan_bench
+#include "header_scan.h"
+#include "http_parser.h"
+#include "bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define ITERATIONS 200000
+#define PARSE_ITERATIONS 20000
+
+// Line ends and the first colon of each line, as the parser needs them
+typedef std::vector<std::pair<size_t, size_t>> Delimiters;
+
+static size_t scan_memchr(std::string_view block, Delimiters& out) {
+    out.clear();
+    size_t pos = 0;
+    while (pos < block.size()) {
+        const char* newline = (const char*)memchr(block.data() + pos, '\n', block.size() - pos);
+        if (!newline) break;
+        size_t end = newline - block.data();
+        size_t colon = block.substr(pos, end - pos).find(':');
+        out.push_back({end, colon == std::string_view::npos ? colon : pos + colon});
+        pos = end + 1;
+    }
+    return out.size();
+}
+
+static size_t scan_delimiters(std::string_view block, Delimiters& out) {
+    out.clear();
+    DelimiterScanner delimiters(block.data(), block.size());
+    while (true) {
+        size_t colon;
+        size_t end = delimiters.next_line(colon);
+        if (end == std::string_view::npos) break;
+        out.push_back({end, colon});
+    }
+    return out.size();
+}
+
+static size_t parse_response(const std::string& response) {
+    ResponseParser parser;
+    parser.feed(response.data(), response.size());
+    return parser.take_response().header_fields.size();
+}
+
+int main() {
+    // A short API reply's headers, and a long one as sent behind nginx with
+    // cookies and security headers
+    std::string small =
+        "HTTP/1.1 200 OK\r\n"
+        "Server: nginx/1.24.0\r\n"
+        "Date: Sat, 17 Oct 2026 04:09:00 GMT\r\n"
+        "Content-Type: application/json; charset=utf-8\r\n"
+        "Content-Length: 9\r\n"
+        "Connection: keep-alive\r\n"
+        "X-Powered-By: Express\r\n"
+        "ETag: W/\"9-abcdefghijklmnopqrstu\"\r\n\r\n";
+    std::string large =
+        "HTTP/1.1 200 OK\r\n"
+        "Server: nginx/1.24.0\r\n"
+        "Date: Sat, 17 Oct 2026 04:09:00 GMT\r\n"
+        "Content-Type: application/json; charset=utf-8\r\n"
+        "Content-Length: 9\r\n"
+        "Connection: keep-alive\r\n"
+        "X-Powered-By: Express\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Access-Control-Allow-Credentials: true\r\n"
+        "Set-Cookie: connect.sid=s%3AbWluZS1zZXNzaW9uLWlkLWZvci10ZXN0aW5nLW9ubHk.Zm9vYmFyYmF6cXV4; Path=/; HttpOnly; SameSite=Lax\r\n"
+        "Set-Cookie: csrf=7f3a9c1e5b2d4f6a8c0e2b4d6f8a0c2e; Path=/; Secure\r\n"
+        "Content-Security-Policy: default-src 'self'; script-src 'self' https://cdn.example.com; style-src 'self' 'unsafe-inline'; img-src 'self' data: https:; connect-src 'self' https://api.example.com\r\n"
+        "Strict-Transport-Security: max-age=31536000; includeSubDomains; preload\r\n"
+        "X-Content-Type-Options: nosniff\r\n"
+        "X-Frame-Options: SAMEORIGIN\r\n"
+        "Referrer-Policy: strict-origin-when-cross-origin\r\n"
+        "X-RateLimit-Limit: 100\r\n"
+        "X-RateLimit-Remaining: 99\r\n"
+        "X-RateLimit-Reset: 1792216200\r\n"
+        "Cache-Control: no-store, no-cache, must-revalidate, proxy-revalidate\r\n"
+        "Pragma: no-cache\r\n"
+        "Expires: 0\r\n"
+        "Vary: Origin, Accept-Encoding\r\n"
+        "ETag: W/\"9-abcdefghijklmnopqrstu\"\r\n"
+        "X-Request-Id: 4f1c2d3e-5a6b-7c8d-9e0f-a1b2c3d4e5f6\r\n\r\n";
+    struct Block {
+        const char* name;
+        std::string headers;
+    };
+    std::vector<Block> blocks = {{"short reply", small}, {"nginx + cookies", large}};
+    ScanIsa default_isa = get_scan_isa();
+    std::vector<ScanIsa> isas;
+    for (ScanIsa isa : {SCAN_MEMCHR, SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2}) {
+        if (set_scan_isa(isa)) isas.push_back(isa);
+    }
+
+    Delimiters expected, got;
+    std::printf("Scan only (line ends + first colon per line)\n%-18s %8s %14s", "headers", "size", "memchr + find");
+    for (ScanIsa isa : isas) std::printf(" %10s", scan_isa_name(isa));
+    std::printf("\n");
+    for (const Block& block : blocks) {
+        scan_memchr(block.headers, expected);
+        std::printf("%-18s %6zu B %11.0f ns", block.name, block.headers.size(),
+                    best_time_per_op([&] { return scan_memchr(block.headers, got); }, ITERATIONS));
+        for (ScanIsa isa : isas) {
+            set_scan_isa(isa);
+            scan_delimiters(block.headers, got);
+            if (got != expected) {
+                std::printf("\n%s: %s scan differs from memchr\n", block.name, scan_isa_name(isa));
+                return EXIT_FAILURE;
+            }
+            std::printf(" %7.0f ns", best_time_per_op([&] { return scan_delimiters(block.headers, got); }, ITERATIONS));
+        }
+        std::printf("\n");
+    }
+
+    std::printf("\nResponseParser::feed per response\n%-18s %8s", "headers", "size");
+    for (ScanIsa isa : isas) std::printf(" %10s", scan_isa_name(isa));
+    std::printf("\n");
+    for (const Block& block : blocks) {
+        std::string response = block.headers + "{\"id\":42}";
+        std::printf("%-18s %6zu B", block.name, response.size());
+        for (ScanIsa isa : isas) {
+            set_scan_isa(isa);
+            std::printf(" %7.0f ns", best_time_per_op([&] { return parse_response(response); }, PARSE_ITERATIONS));
+        }
+        std::printf("\n");
+    }
+    std::printf("\nDefault on this CPU: %s\n", scan_isa_name(default_isa));
+    return 0;
+}
@@ -0,0 +1,118 @@
+// JsonObjectReader field lookups against json::parse of the whole reply,
+// which the handlers did before, on reply shapes the client reads and on a
+// field placed after a long movie list. Every lookup is checked against the
+// parsed document first.
+// Run: make bench && bench/json_reader_bench
+#include "json_reader.h"
+#include "nlohmann/json.hpp"
+#include "bench.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+#define ITERATIONS 100000
+#define LIST_MOVIES 100000
+#define LIST_ITERATIONS 5
+
+// A field read from a reply: a string, or an int when is_int
+struct Lookup {
+    std::string key;
+    bool is_int;
+};
+
+// Reads every lookup with the on-demand reader, as the handlers do; the
+// total length of what was read, 0 if a field was missing
+static size_t read_fields(const std::string& document, const std::vector<Lookup>& lookups) {
+    JsonObjectReader reader(document);
+    size_t total = 0;
+    for (const Lookup& lookup : lookups) {
+        std::string text;
+        int number;
+        if (lookup.is_int ? !reader.get_int(lookup.key, number) : !reader.get_string(lookup.key, text)) {
+            return 0;
+        }
+        total += lookup.is_int ? sizeof(number) : text.size() + 1;
+    }
+    return total;
+}
+
+// Same through a parsed document
+static size_t parse_fields(const std::string& document, const std::vector<Lookup>& lookups) {
+    json parsed = json::parse(document);
+    size_t total = 0;
+    for (const Lookup& lookup : lookups) {
+        if (lookup.is_int) {
+            parsed[lookup.key].get<int>();
+            total += sizeof(int);
+        } else {
+            total += parsed[lookup.key].get<std::string>().size() + 1;
+        }
+    }
+    return total;
+}
+
+// Whether the reader returns the same values as the parsed document
+static bool same_fields(const std::string& document, const std::vector<Lookup>& lookups) {
+    json parsed = json::parse(document);
+    JsonObjectReader reader(document);
+    for (const Lookup& lookup : lookups) {
+        std::string text;
+        int number;
+        if (lookup.is_int) {
+            if (!reader.get_int(lookup.key, number) || number != parsed[lookup.key].get<int>()) return false;
+        } else {
+            if (!reader.get_string(lookup.key, text) || text != parsed[lookup.key].get<std::string>()) return false;
+        }
+    }
+    return true;
+}
+
+struct Case {
+    const char* name;
+    std::string document;
+    std::vector<Lookup> lookups;
+    int iterations;
+};
+
+int main() {
+    std::string movie = "{\"id\":1234,\"title\":\"The \\\"Matrix\\\"\",\"year\":1999,"
+                        "\"description\":\"A hacker learns the truth \\u00e9 about his world\",\"rating\":\"8.7\"}";
+    std::string list = "{\"movies\":[";
+    for (int i = 0; i < LIST_MOVIES; i++) {
+        if (i > 0) list += ",";
+        list += "{\"id\":" + std::to_string(i) + ",\"title\":\"Movie " + std::to_string(i)
+              + "\",\"description\":\"Nested {braces} and [brackets] in a string\"}";
+    }
+    list += "],\"id\":42}";
+
+    std::vector<Case> cases = {
+        {"id reply", "{\"id\": 48213, \"title\": \"Favourites\"}", {{"id", true}}, ITERATIONS},
+        {"token reply", "{\"token\": \"" + std::string(120, 't') + "\"}", {{"token", false}}, ITERATIONS},
+        {"get_movie, 4 fields", movie,
+         {{"title", false}, {"year", true}, {"description", false}, {"rating", false}}, ITERATIONS},
+        {"id after movie list", list, {{"id", true}}, LIST_ITERATIONS},
+    };
+
+    std::printf("%-22s %10s %14s %14s %8s\n", "reply", "size", "json::parse", "on-demand", "speedup");
+    for (const Case& c : cases) {
+        if (!same_fields(c.document, c.lookups)) {
+            std::printf("%s: on-demand reader disagrees with json::parse\n", c.name);
+            return EXIT_FAILURE;
+        }
+        double parse_ns = best_time_per_op([&] { return parse_fields(c.document, c.lookups); }, c.iterations);
+        double read_ns = best_time_per_op([&] { return read_fields(c.document, c.lookups); }, c.iterations);
+        std::printf("%-22s %8zu B %11.0f ns %11.0f ns %7.1fx\n", c.name, c.document.size(), parse_ns, read_ns,
+                    parse_ns / read_ns);
+    }
+
+    // Throughput on the long list, in GB/s (bytes per ns)
+    const Case& longest = cases.back();
+    double parse_ns = best_time_per_op([&] { return parse_fields(longest.document, longest.lookups); }, LIST_ITERATIONS);
+    double read_ns = best_time_per_op([&] { return read_fields(longest.document, longest.lookups); }, LIST_ITERATIONS);
+    std::printf("\n%d-movie list (%.1f MB): json::parse %.3f GB/s, on-demand %.3f GB/s\n", LIST_MOVIES,
+                longest.document.size() / 1e6, longest.document.size() / parse_ns, longest.document.size() / read_ns);
+    return 0;
+}
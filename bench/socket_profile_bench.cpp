@@ -0,0 +1,130 @@
+// Request latency on one keep-alive loopback connection for each socket
+// profile (socket_options.h). A small in-process server answers every
+// request at once, so the times are the client's request path plus the
+// loopback round trip. Run: make bench && bench/socket_profile_bench
+#include "connection.h"
+#include "socket_options.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define REQUESTS 2000
+#define SERVER_BUFFER 65536
+
+static const char REPLY[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 9\r\n\r\n{\"id\":1}\n";
+
+// Length of the first complete request in data, 0 if it isn't all there
+static size_t complete_request(const std::string& data) {
+    size_t end = data.find("\r\n\r\n");
+    if (end == std::string::npos) return 0;
+    size_t length = 0;
+    size_t field = data.find("Content-Length: ");
+    if (field != std::string::npos && field < end) {
+        length = strtoul(data.c_str() + field + strlen("Content-Length: "), nullptr, 10);
+    }
+    return data.size() >= end + 4 + length ? end + 4 + length : 0;
+}
+
+static void serve_connection(int client) {
+    int one = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::string pending;
+    char buffer[SERVER_BUFFER];
+    while (true) {
+        ssize_t bytes = read(client, buffer, sizeof(buffer));
+        if (bytes <= 0) break;
+        pending.append(buffer, bytes);
+        while (size_t length = complete_request(pending)) {
+            pending.erase(0, length);
+            if (write(client, REPLY, sizeof(REPLY) - 1) < 0) break;
+        }
+    }
+    close(client);
+}
+
+// Listens on a free loopback port; returns it, 0 on failure
+static int start_server() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr*)&addr, addr_len) < 0 || listen(listener, 16) < 0
+        || getsockname(listener, (struct sockaddr*)&addr, &addr_len) < 0) {
+        return 0;
+    }
+    std::thread([listener] {
+        while (true) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) break;
+            std::thread(serve_connection, client).detach();
+        }
+    }).detach();
+    return ntohs(addr.sin_port);
+}
+
+struct Profile {
+    const char* name;
+    SocketProfile options;
+};
+
+int main() {
+    int port = start_server();
+    if (port == 0) {
+        std::printf("could not start the loopback server\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Profile> profiles(5);
+    profiles[0].name = "kernel defaults";
+    profiles[0].options.tcp_nodelay = false;
+    profiles[1].name = "nodelay";
+    profiles[2].name = "nodelay+quickack";
+    profiles[2].options.tcp_quickack = true;
+    profiles[3].name = "nodelay+256K buffers";
+    profiles[3].options.send_buffer = profiles[3].options.receive_buffer = 262144;
+    profiles[4].name = "nodelay+fastopen";
+    profiles[4].options.tcp_fastopen = true;
+
+    std::string jwt(180, 'j');
+    std::string get = compute_get_request("127.0.0.1", "/api/v1/tema/library/movies/1", "", {}, jwt);
+    HttpRequest post = prepare_post_request("127.0.0.1", "/api/v1/tema/library/movies", "application/json",
+                                            std::string("{\"title\":\"Matrix\",\"year\":1999,\"description\":\"A film\",\"rating\":8.7}"),
+                                            {}, jwt);
+
+    // Alternating GET / POST; the first round only warms up
+    std::printf("%-22s %10s %10s\n", "profile", "p50", "p99");
+    for (int round = 0; round < 2; round++) {
+        for (const Profile& profile : profiles) {
+            set_socket_profile(profile.options);
+            ConnectionManager server("127.0.0.1", port);
+            std::vector<double> latencies;
+            for (int i = 0; i < REQUESTS; i++) {
+                auto start = std::chrono::steady_clock::now();
+                HttpResponse response = i % 2 ? server.send(post) : server.send(get);
+                latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                if (response.status_code != 200) {
+                    std::printf("%s: request failed (%s)\n", profile.name, net_error_message(response.net_error));
+                    return EXIT_FAILURE;
+                }
+            }
+            std::sort(latencies.begin(), latencies.end());
+            if (round > 0) {
+                std::printf("%-22s %7.1f us %7.1f us\n", profile.name,
+                            latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+            }
+        }
+    }
+    return 0;
+}
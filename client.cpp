@@ -1,27 +1,102 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <set>
+#include <memory>
+#include <sstream>
+#include <future>
 #include "helpers.h"
 #include "http_requests.h"
+#include "connection.h"
+#include "session.h"
+#include "worker_pool.h"
+#include "client_config.h"
+#include "json_stream.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "coro_requests.h"
 #include "client.h"
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
 
-std::string admin_cookie;
-std::string user_cookie;
-std::string jwt_token;
-std::string admin_username;
-int sockfd = -1; // Global socket descriptor
-std::vector<int> movie_ids, collection_ids;
-std::set<std::string> logged_users;
+ClientConfig config; // Endpoint and transport options, read at startup
+Session session; // Cookies, JWT and the index -> ID mappings
+std::shared_ptr<LoadBalancer> balancer; // Endpoints, shared by the connection and the worker pool
+std::unique_ptr<ConnectionManager> server; // Keep-alive connection shared by all commands
+std::unique_ptr<WorkerPool> workers; // Started on first use, for parallel read-only requests
+
+// Request payloads, laid out at compile time
+constexpr auto CREDENTIALS_PAYLOAD = json_shape("username", "password");
+constexpr auto USER_LOGIN_PAYLOAD = json_shape("admin_username", "username", "password");
+constexpr auto MOVIE_PAYLOAD = json_shape("title", "year", "description", "rating");
+constexpr auto TITLE_PAYLOAD = json_shape("title");
+constexpr auto ID_PAYLOAD = json_shape("id");
 
 void close_server_connection() {
-    if (sockfd >= 0) {
-        close_connection(sockfd);
-        sockfd = -1;
+    workers.reset(); // Joins the workers, which close their connections
+    if (server) server->close();
+}
+
+std::string api_url(const std::string& route) {
+    return config.base_path + route;
+}
+
+bool read_indexes(const std::string& line, std::vector<int>& indexes) {
+    std::istringstream stream(line);
+    std::string index;
+    indexes.clear();
+    while (stream >> index) {
+        if (!is_number(index)) return false;
+        indexes.push_back(std::stoi(index));
+    }
+    return !indexes.empty();
+}
+
+WorkerPool& worker_pool() {
+    if (!workers) workers.reset(new WorkerPool(balancer, config.workers));
+    return *workers;
+}
+
+std::vector<HttpResponse> send_parallel(std::vector<std::string> requests) {
+    std::vector<HttpResponse> responses;
+    if (requests.size() == 1) {
+        responses.push_back(server->send(requests[0]));
+        return responses;
     }
+
+    std::vector<std::future<HttpResponse>> pending;
+    for (std::string& request : requests) {
+        pending.push_back(worker_pool().submit(std::move(request)));
+    }
+    for (std::future<HttpResponse>& response : pending) {
+        responses.push_back(response.get());
+    }
+    return responses;
+}
+
+HttpResponse stream_titles(const std::string& request, const std::string& list_key,
+                           const std::string& heading, const std::string& separator,
+                           const std::string& command_name) {
+    int counter = 0;
+    bool started = false;
+    JsonListScanner scanner(list_key, "title", [&](std::string_view title, bool found) {
+        std::cout << "#" << ++counter << separator << (found ? title : "N/A") << '\n';
+    });
+
+    // Only a successful reply reaches the sink; one flush per piece received
+    HttpResponse res = server->send(request, [&](const char* data, size_t length) {
+        if (!started) {
+            print_success(heading);
+            started = true;
+        }
+        scanner.feed(data, length);
+        std::cout.flush();
+    });
+
+    if (!res.is_error() && !scanner.complete()) {
+        print_error("Failed to " + command_name + ". The reply is not a valid " + list_key + " list.");
+    }
+    return res;
 }
 
 bool validate_credentials(const std::string &username, const std::string &password)
@@ -42,19 +117,36 @@ bool validate_credentials(const std::string &username, const std::string &passwo
     return true;
 }
 
-void build_error_message(HttpResponse response, const std::string &command_name) {
+void build_error_message(const HttpResponse& response, const std::string &command_name) {
+    if (response.status_code == 0 && response.net_error != NET_OK) {
+        print_error("Failed to " + command_name + ". " + net_error_message(response.net_error));
+        return;
+    }
     std::string error_msg = "Failed to " + command_name + ". HTTP " + std::to_string(response.status_code);
-    if (!response.body.empty()) {
-        json err_json = json::parse(response.body);
-        if (err_json.contains("error")) error_msg += " Server: " + err_json["error"].get<std::string>();
-        else error_msg += " Server response body: " + response.body;
+    if (!response.body().empty()) {
+        std::string server_error;
+        if (JsonObjectReader(response.body()).get_string("error", server_error)) error_msg += " Server: " + server_error;
+        else error_msg += " Server response body: " + std::string(response.body());
     }
     print_error(error_msg);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     std::string command;
 
+    // Defaults < config file < environment < command line (client_config.h)
+    std::string config_error;
+    if (!load_client_config(argc, argv, config, config_error)) {
+        print_error(config_error);
+        return 1;
+    }
+    for (const std::string& warning : config.warnings) {
+        print_warning(warning);
+    }
+    apply_client_config(config);
+    balancer = make_load_balancer(config);
+    server.reset(new ConnectionManager(balancer));
+
     while (1) {
         std::cin >> command;
         if (std::cin.eof() || command == "exit") {
@@ -62,12 +154,6 @@ int main() {
         }
         std::cin.ignore(); // Consume the newline after reading the command
 
-        sockfd = open_connection(HOST, PORT);
-        if (sockfd < 0) {
-            print_error("Connection with server failed. Closing");
-            return 1;
-        }
-
         if (command == "login_admin") handle_login_admin();
         else if (command == "add_user") handle_add_user();
         else if (command == "get_users") handle_get_users();
@@ -102,35 +188,32 @@ void handle_login_admin() {
 
     if (!validate_credentials(username, password))
         return;
-    if (!admin_cookie.empty()) {
+    if (session.admin_logged_in()) {
         print_error("Admin already logged in.");
         return;
     }
 
-    json payload = {
-        {"username", username},
-        {"password", password}
-    };
+    std::string payload = CREDENTIALS_PAYLOAD.encode(username, password);
 
-    std::string request = compute_post_request(HOST, "/api/v1/tema/admin/login", "application/json", payload, {}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    HttpRequest request = prepare_post_request(config.host, api_url("/admin/login"), "application/json", std::move(payload), *session.header_block(AUTH_NONE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "login admin");
     } else {
-        admin_cookie = get_cookie_value(res.full_response, "session");
-        if (admin_cookie.empty()) {
+        std::string cookie = get_cookie_value(res, "session");
+        if (cookie.empty()) {
             print_error("Admin login succeeded but no session cookie received.");
         } else {
-            admin_username = username;
-            std::cout << "Admin username: " + admin_username << "\n";
+            session.set_admin(cookie, username);
+            std::cout << "Admin username: " + username << "\n";
             print_success("Admin authenticated successfully.");
         }
     }
 }
 
 void handle_add_user() {
-    if (admin_cookie.empty()) {
+    if (!session.admin_logged_in()) {
         print_error("Admin not logged in. Please login_admin first.");
         return;
     }
@@ -138,31 +221,28 @@ void handle_add_user() {
     std::string username = read_line_with_prompt("username=");
     std::string password = read_line_with_prompt("password=");
 
-    json payload = {
-        {"username", username},
-        {"password", password}
-    };
+    std::string payload = CREDENTIALS_PAYLOAD.encode(username, password);
 
-    std::string request = compute_post_request(HOST, "/api/v1/tema/admin/users", "application/json", payload, {admin_cookie}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    HttpRequest request = prepare_post_request(config.host, api_url("/admin/users"), "application/json", std::move(payload), *session.header_block(AUTH_ADMIN_COOKIE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "add user");
     else print_success("User added.");
 }
 
 void handle_get_users() {
-    if (admin_cookie.empty()) {
+    if (!session.admin_logged_in()) {
         print_error("Admin not logged in.");
         return;
     }
 
-    std::string request = compute_get_request(HOST, "/api/v1/tema/admin/users", "", {admin_cookie}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_get_request(config.host, api_url("/admin/users"), "", *session.header_block(AUTH_ADMIN_COOKIE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "get users");
     } else {
-        json users_json = json::parse(res.body);
+        json users_json = json::parse(res.body());
         if (users_json.contains("users") && users_json["users"].is_array()) {
             print_success("User list:");
             int users_count = 0;
@@ -178,15 +258,15 @@ void handle_get_users() {
 }
 
 void handle_delete_user() {
-    if (admin_cookie.empty()) {
+    if (!session.admin_logged_in()) {
         print_error("Admin not logged in. Please login_admin first.");
         return;
     }
     std::string username = read_line_with_prompt("username=");
-    std::string url = "/api/v1/tema/admin/users/" + username;
+    std::string url = api_url("/admin/users/") + username;
 
-    std::string request = compute_delete_request(HOST, url, {admin_cookie}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_delete_request(config.host, url, *session.header_block(AUTH_ADMIN_COOKIE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "delete user");
@@ -196,12 +276,12 @@ void handle_delete_user() {
 }
 
 void handle_logout_admin() {
-    if (admin_cookie.empty()) {
+    if (!session.admin_logged_in()) {
         print_error("Admin not logged in. Nothing to logout from.");
         return;
     }
-    std::string request = compute_get_request(HOST, "/api/v1/tema/admin/logout", "", {admin_cookie}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_get_request(config.host, api_url("/admin/logout"), "", *session.header_block(AUTH_ADMIN_COOKIE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "logout admin");
@@ -209,12 +289,12 @@ void handle_logout_admin() {
         print_success("Admin logged out successfully.");
     }
 
-    admin_cookie.clear(); // Cookie shouldn't exist no more regardless of server response
+    session.clear_admin_cookie(); // Cookie shouldn't exist no more regardless of server response
 }
 
 void handle_login() {
     std::string admin_username_stdin = read_line_with_prompt("admin_username=");
-    if (admin_username_stdin != admin_username) {
+    if (admin_username_stdin != session.admin_username()) {
         print_error("Wrong admin username.");
         return;
     }
@@ -224,41 +304,38 @@ void handle_login() {
     if (!validate_credentials(username, password))
         return;
 
-    json payload = {
-        {"admin_username", admin_username},
-        {"username", username},
-        {"password", password}
-    };
+    std::string payload = USER_LOGIN_PAYLOAD.encode(admin_username_stdin, username, password);
     
-    std::string request = compute_post_request(HOST, "/api/v1/tema/user/login", "application/json", payload, {}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    HttpRequest request = prepare_post_request(config.host, api_url("/user/login"), "application/json", std::move(payload), *session.header_block(AUTH_NONE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "login");
     } else {
-        user_cookie = get_cookie_value(res.full_response, "session");
-        if (user_cookie.empty()) {
+        std::string cookie = get_cookie_value(res, "session");
+        if (cookie.empty()) {
             print_error("User login succeeded but no session cookie received.");
         } else {
+            session.set_user_cookie(cookie);
             print_success("User authenticated successfully.");
         }
     }
 }
 
 void handle_get_access() {
-    if (user_cookie.empty()) {
+    if (!session.user_logged_in()) {
         print_error("User not logged in. Please login first.");
         return;
     }
-    std::string request = compute_get_request(HOST, "/api/v1/tema/library/access", "", {user_cookie}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_get_request(config.host, api_url("/library/access"), "", *session.header_block(AUTH_USER_COOKIE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "get access");
     } else {
-        json access_json = json::parse(res.body);
-        if (access_json.contains("token")) {
-            jwt_token = access_json["token"].get<std::string>();
+        std::string token;
+        if (JsonObjectReader(res.body()).get_string("token", token)) {
+            session.set_jwt_token(token);
             print_success("Library access granted. JWT token received.");
         } else {
             print_error("Library access response did not contain a token.");
@@ -267,59 +344,73 @@ void handle_get_access() {
 }
 
 void handle_get_movies() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
-    std::string request = compute_get_request(HOST, "/api/v1/tema/library/movies", "", {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_get_request(config.host, api_url("/library/movies"), "", *session.header_block(AUTH_JWT));
+    HttpResponse res = stream_titles(request, "movies", "Movies list:", " ", "get movies");
 
     if (res.is_error()) {
         build_error_message(res, "get movies");
-    } else {
-        json response_json = json::parse(res.body);
-        json movies_array = response_json["movies"];
-
-        print_success("Movies list:");
-        int movie_counter = 0;
-        for (const auto& movie : movies_array) {
-            std::string title = movie.value("title", "N/A");
-            std::cout << "#" << ++movie_counter << " " << title << std::endl;
-        }
     }
 }
 
+void print_movie(const HttpResponse& res, const std::string& movie_id) {
+    if (res.is_error()) {
+        build_error_message(res, "get movie");
+        return;
+    }
+
+    JsonObjectReader movie_json(res.body());
+    std::string title, description, rating;
+    int year;
+    if (!movie_json.get_string("title", title) || !movie_json.get_int("year", year)
+        || !movie_json.get_string("description", description) || !movie_json.get_string("rating", rating)) {
+        print_error("Failed to get movie. The reply is missing movie fields.");
+        return;
+    }
+    print_success("Movie details (ID: " + movie_id + "):");
+    std::cout << "title: " << title << std::endl;
+    std::cout << "year: " << year << std::endl;
+    std::cout << "description: " << description << std::endl;
+    std::cout << "rating: " << rating << std::endl;
+}
+
 void handle_get_movie() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
     std::string id = read_line_with_prompt("id=");
-    if (std::stoi(id) > (int)movie_ids.size()) {
+    std::vector<int> indexes;
+    if (!read_indexes(id, indexes)) {
         print_error("Invalid movie ID.");
         return;
     }
 
-    std::string movie_id = std::to_string(movie_ids[std::stoi(id) - 1]);
-    std::string url = "/api/v1/tema/library/movies/" + movie_id;
-
-    std::string request = compute_get_request(HOST, url, "", {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    // All IDs are checked before anything is sent
+    std::shared_ptr<const std::string> headers = session.header_block(AUTH_JWT);
+    std::vector<std::string> movie_ids, requests;
+    for (int index : indexes) {
+        int server_id;
+        if (!session.find_movie_id(index, server_id)) {
+            print_error("Invalid movie ID.");
+            return;
+        }
+        movie_ids.push_back(std::to_string(server_id));
+        std::string url = api_url("/library/movies/") + movie_ids.back();
+        requests.push_back(compute_get_request(config.host, url, "", *headers));
+    }
 
-    if (res.is_error()) {
-        build_error_message(res, "get movie");
-    } else {
-        json movie_json = json::parse(res.body);
-        print_success("Movie details (ID: " + movie_id + "):");
-        std::cout << "title: " << movie_json["title"].get<std::string>() << std::endl;
-        std::cout << "year: " << movie_json["year"].get<int>() << std::endl;
-        std::cout << "description: " << movie_json["description"].get<std::string>() << std::endl;
-        std::cout << "rating: " << movie_json["rating"].get<std::string>() << std::endl;
+    std::vector<HttpResponse> responses = send_parallel(std::move(requests));
+    for (size_t i = 0; i < responses.size(); i++) {
+        print_movie(responses[i], movie_ids[i]);
     }
 }
 
 void handle_add_movie() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
@@ -334,50 +425,49 @@ void handle_add_movie() {
         return;
     }
 
-    json payload = {
-        {"title", title},
-        {"year", std::stoi(year)},
-        {"description", description},
-        {"rating", std::stod(rating)}
-    };
+    std::string payload = MOVIE_PAYLOAD.encode(title, std::stoi(year), description, std::stod(rating));
 
-    std::string request = compute_post_request(HOST, "/api/v1/tema/library/movies", "application/json", payload, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    HttpRequest request = prepare_post_request(config.host, api_url("/library/movies"), "application/json", std::move(payload), *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) {
         build_error_message(res, "add movie");
     } else {
-        int movie_id = json::parse(res.body)["id"].get<int>();
-        movie_ids.push_back(movie_id);
+        int movie_id;
+        if (!JsonObjectReader(res.body()).get_int("id", movie_id)) {
+            print_error("Failed to add movie. The reply has no movie ID.");
+            return;
+        }
+        session.add_movie_id(movie_id);
         print_success("Movie added successfully.");
     }
 }
 
 void handle_delete_movie() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
 
     std::string id = read_line_with_prompt("id=");
-    if (!is_number(id) || std::stoi(id) > (int)movie_ids.size()) {
+    int server_id;
+    if (!is_number(id) || !session.take_movie_id(std::stoi(id), server_id)) {
         print_error("Invalid ID.");
         return;
     }
-    
-    movie_ids.erase(movie_ids.begin() + std::stoi(id) - 1);
-    std::string movie_id = std::to_string(movie_ids[std::stoi(id) - 1]);
-    std::string url = "/api/v1/tema/library/movies/" + movie_id;
 
-    std::string request = compute_delete_request(HOST, url, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string movie_id = std::to_string(server_id);
+    std::string url = api_url("/library/movies/") + movie_id;
+
+    std::string request = compute_delete_request(config.host, url, *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "delete movie");
     else print_success("Movie " + movie_id + " deleted successfully.");
 }
 
 void handle_update_movie() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
@@ -393,88 +483,134 @@ void handle_update_movie() {
         return;
     }
 
-    if (!is_number(id) || std::stoi(id) > (int)movie_ids.size()) {
+    int server_id;
+    if (!is_number(id) || !session.find_movie_id(std::stoi(id), server_id)) {
         print_error("Invalid ID.");
         return;
     }
 
-    std::string movie_id = std::to_string(movie_ids[std::stoi(id) - 1]);
-    std::string url = "/api/v1/tema/library/movies/" + movie_id;
+    std::string movie_id = std::to_string(server_id);
+    std::string url = api_url("/library/movies/") + movie_id;
 
-    json payload = {
-        {"title", new_title},
-        {"year", year},
-        {"description", description},
-        {"rating", std::stod(rating)}
-    };
+    std::string payload = MOVIE_PAYLOAD.encode(new_title, year, description, std::stod(rating));
     
-    std::string request = compute_put_request(HOST, url, "application/json", payload, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    HttpRequest request = prepare_put_request(config.host, url, "application/json", std::move(payload), *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "update movie");
     else print_success("Movie " + movie_id + " updated successfully.");
 }
 
 void handle_get_collections() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
 
-    std::string request = compute_get_request(HOST, "/api/v1/tema/library/collections", "", {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_get_request(config.host, api_url("/library/collections"), "", *session.header_block(AUTH_JWT));
+    HttpResponse res = stream_titles(request, "collections", "Collections list:", ": ", "get collections");
 
     if (res.is_error()) {
         build_error_message(res, "get collections");
-    } else {
-        json response_json = json::parse(res.body);
-        json collections = response_json["collections"];
-        
-        print_success("Collections list:");
-        int collection_count = 0;
-        for (const auto& coll : collections) { 
-            std::string title = coll.value("title", "N/A");
-            std::cout << "#" << ++collection_count << ": " << title << std::endl;
+    }
+}
+
+void print_collection(const HttpResponse& res, int coll_id) {
+    if (res.is_error()) {
+        build_error_message(res, "get collection");
+        return;
+    }
+
+    json coll_json = json::parse(res.body());
+    print_success("Collection details (ID: " + std::to_string(coll_id) + "):");
+    std::cout << "title: " << coll_json["title"].get<std::string>() << std::endl;
+    std::cout << "owner: " << coll_json["owner"].get<std::string>() << std::endl;
+    if (coll_json.contains("movies") && coll_json["movies"].is_array()) {
+        std::cout << "Movies in collection:" << std::endl;
+        for (const auto& movie : coll_json["movies"]) {
+            std::cout << "#" << movie["id"].get<int>() << ": " << movie["title"].get<std::string>() << std::endl;
         }
     }
 }
 
 void handle_get_collection() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
 
     std::string id = read_line_with_prompt("id=");
-    if (!is_number(id) || std::stoi(id) <= 0 || std::stoi(id) > (int)collection_ids.size()) {
+    std::vector<int> indexes;
+    if (!read_indexes(id, indexes)) {
         print_error("Invalid ID.");
         return;
     }
 
-    int coll_id = collection_ids[std::stoi(id) - 1];
-    std::string url = "/api/v1/tema/library/collections/" + std::to_string(coll_id);
+    std::shared_ptr<const std::string> headers = session.header_block(AUTH_JWT);
+    std::vector<int> coll_ids;
+    std::vector<std::string> requests;
+    for (int index : indexes) {
+        int coll_id;
+        if (!session.find_collection_id(index, coll_id)) {
+            print_error("Invalid ID.");
+            return;
+        }
+        coll_ids.push_back(coll_id);
+        std::string url = api_url("/library/collections/") + std::to_string(coll_id);
+        requests.push_back(compute_get_request(config.host, url, "", *headers));
+    }
+
+    std::vector<HttpResponse> responses = send_parallel(std::move(requests));
+    for (size_t i = 0; i < responses.size(); i++) {
+        print_collection(responses[i], coll_ids[i]);
+    }
+}
+
+std::vector<HttpRequest> collection_movie_requests(int coll_id, const std::vector<int>& movie_ids) {
+    std::string url = api_url("/library/collections/") + std::to_string(coll_id) + "/movies";
+    std::shared_ptr<const std::string> headers = session.header_block(AUTH_JWT);
+    std::vector<HttpRequest> requests;
+    for (int movie_id : movie_ids) {
+        std::string payload = ID_PAYLOAD.encode(movie_id); // {"id": Number} for movie ID
+        requests.push_back(prepare_post_request(config.host, url, "application/json", std::move(payload), *headers));
+    }
+    return requests;
+}
+
+void report_collection_movies(const std::vector<int>& ids, const std::vector<HttpResponse>& responses) {
+    for (size_t i = 0; i < responses.size(); i++) {
+        if (responses[i].is_error())
+            build_error_message(responses[i], "add movie " + std::to_string(ids[i]) + " to collection");
+    }
+}
 
-    std::string request = compute_get_request(HOST, url, "", {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+#ifdef HTTP_CLIENT_COROUTINES
+// Straight-line version of add_collection: the collection is created by a
+// pool worker, then the movie POSTs are pipelined on the shared connection
+Task add_collection_task(CoroScheduler& scheduler, std::string title, std::vector<int> ids,
+                         std::vector<int> movie_ids) {
+    HttpResponse res = co_await async_send_request(scheduler,
+        prepare_post_request(config.host, api_url("/library/collections"), "application/json", TITLE_PAYLOAD.encode(title), *session.header_block(AUTH_JWT)));
 
+    int coll_id;
     if (res.is_error()) {
-        build_error_message(res, "get collection");
-    } else {
-        json coll_json = json::parse(res.body);
-        print_success("Collection details (ID: " + std::to_string(coll_id) + "):");
-        std::cout << "title: " << coll_json["title"].get<std::string>() << std::endl;
-        std::cout << "owner: " << coll_json["owner"].get<std::string>() << std::endl;
-        if (coll_json.contains("movies") && coll_json["movies"].is_array()) {
-            std::cout << "Movies in collection:" << std::endl;
-            for (const auto& movie : coll_json["movies"]) {
-                std::cout << "#" << movie["id"].get<int>() << ": " << movie["title"].get<std::string>() << std::endl;
-            }
-        }
+        build_error_message(res, "add collection");
+        co_return;
     }
+    if (!JsonObjectReader(res.body()).get_int("id", coll_id)) {
+        print_error("Failed to add collection. The reply has no collection ID.");
+        co_return;
+    }
+    session.add_collection_id(coll_id);
+
+    std::vector<HttpResponse> responses = co_await async_send_all(scheduler, collection_movie_requests(coll_id, movie_ids));
+    report_collection_movies(ids, responses);
+    print_success("Collection added successfully.");
 }
+#endif
 
 void handle_add_collection() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
@@ -486,118 +622,129 @@ void handle_add_collection() {
         return;
     }
 
-    std::vector<int> ids;
+    // Indexes as typed (for the report) and the server IDs behind them
+    std::vector<int> ids, movie_ids;
     for (int i = 0; i < std::stoi(num_movies); i++) {
         std::string prompt = "movie_id[" + std::to_string(i) + "]=";
         std::string movie_id = read_line_with_prompt(prompt);
-        if (!is_number(movie_id) || std::stoi(movie_id) > (int)movie_ids.size()) {
+        int server_id;
+        if (!is_number(movie_id) || !session.find_movie_id(std::stoi(movie_id), server_id)) {
             print_error("Invalid ID.");
             return;
         }
         ids.push_back(std::stoi(movie_id));
+        movie_ids.push_back(server_id);
     }
 
-    json payload = { {"title", title} };
-    std::string request = compute_post_request(HOST, "/api/v1/tema/library/collections", "application/json", payload, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+#ifdef HTTP_CLIENT_COROUTINES
+    CoroScheduler scheduler(*server, worker_pool());
+    scheduler.spawn(add_collection_task(scheduler, title, ids, movie_ids));
+    scheduler.run();
+#else
+    std::string payload = TITLE_PAYLOAD.encode(title);
+    HttpRequest request = prepare_post_request(config.host, api_url("/library/collections"), "application/json", std::move(payload), *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
+    int coll_id;
     if (res.is_error()) {
         build_error_message(res, "add collection");
+    } else if (!JsonObjectReader(res.body()).get_int("id", coll_id)) {
+        print_error("Failed to add collection. The reply has no collection ID.");
     } else {
-        int coll_id = json::parse(res.body)["id"].get<int>();
-        collection_ids.push_back(coll_id);
-        std::string url = "/api/v1/tema/library/collections/" + std::to_string(coll_id) + "/movies";
-
-        for (int i = 0; i < std::stoi(num_movies); i++) {
-            json payload = { {"id", movie_ids[ids[i] - 1]} }; // Payload is {"id": Number} for movie ID
-            std::string request = compute_post_request(HOST, url, "application/json", payload, {}, jwt_token);
-            send_request_get_reply(sockfd, request); // Send POST for every movie added in collection
-        }
+        session.add_collection_id(coll_id);
+
+        // One POST per movie, all pipelined on the same connection
+        std::vector<HttpResponse> responses = server->send_pipelined(collection_movie_requests(coll_id, movie_ids));
+        report_collection_movies(ids, responses);
         print_success("Collection added successfully.");
     }
+#endif
 }
 
 void handle_delete_collection() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
 
     std::string coll_id = read_line_with_prompt("id=");
-    if (!is_number(coll_id) || std::stoi(coll_id) <= 0 || std::stoi(coll_id) > (int)collection_ids.size()) {
+    // Forgotten whether or not the server deletes it
+    int server_id;
+    if (!is_number(coll_id) || !session.take_collection_id(std::stoi(coll_id), server_id)) {
         print_error("Invalid ID.");
         return;
     }
-    std::string url = "/api/v1/tema/library/collections/" + std::to_string(collection_ids[std::stoi(coll_id) - 1]);
+    std::string url = api_url("/library/collections/") + std::to_string(server_id);
 
-    std::string request = compute_delete_request(HOST, url, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
-    collection_ids.erase(collection_ids.begin() + std::stoi(coll_id) - 1);
+    std::string request = compute_delete_request(config.host, url, *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "delete collection");
     else print_success("Collection " + coll_id + " deleted successfully.");
 }
 
 void handle_add_movie_to_collection() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
 
     std::string coll_id = read_line_with_prompt("collection_id=");
     std::string movie_id = read_line_with_prompt("movie_id=");
-    if (!is_number(coll_id) || !is_number(movie_id) || std::stoi(coll_id) <= 0 || std::stoi(coll_id) > (int)collection_ids.size()
-        || std::stoi(movie_id) <= 0 || std::stoi(movie_id) > (int)movie_ids.size()) {
+    int coll_server_id, movie_server_id;
+    if (!is_number(coll_id) || !is_number(movie_id) || !session.find_collection_id(std::stoi(coll_id), coll_server_id)
+        || !session.find_movie_id(std::stoi(movie_id), movie_server_id)) {
         print_error("Collection and movie ids must be valid numbers");
         return;
     }
-    std::string url = "/api/v1/tema/library/collections/" + std::to_string(collection_ids[std::stoi(coll_id) - 1]) + "/movies";
+    std::string url = api_url("/library/collections/") + std::to_string(coll_server_id) + "/movies";
     
-    json payload = { {"id", movie_ids[std::stoi(movie_id) - 1]} }; // Payload is {"id": Number} for movie ID
+    std::string payload = ID_PAYLOAD.encode(movie_server_id); // {"id": Number} for movie ID
 
-    std::string request = compute_post_request(HOST, url, "application/json", payload, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    HttpRequest request = prepare_post_request(config.host, url, "application/json", std::move(payload), *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "add movie to collection");
     else print_success("Movie added to collection successfully.");
 }
 
 void handle_delete_movie_from_collection() {
-    if (jwt_token.empty()) {
+    if (!session.has_library_access()) {
         print_error("No library access.");
         return;
     }
 
     std::string coll_id = read_line_with_prompt("collection_id=");
     std::string movie_id = read_line_with_prompt("movie_id=");
-    if (!is_number(coll_id) || !is_number(movie_id) || std::stoi(coll_id) <= 0 || std::stoi(coll_id) > (int)collection_ids.size()
-        || std::stoi(movie_id) <= 0 || std::stoi(movie_id) > (int)movie_ids.size()) {
+    int coll_server_id, movie_server_id;
+    if (!is_number(coll_id) || !is_number(movie_id) || !session.find_collection_id(std::stoi(coll_id), coll_server_id)
+        || !session.find_movie_id(std::stoi(movie_id), movie_server_id)) {
         print_error("Collection and movie ids must be valid numbers.");
         return;
     }
 
-    std::string url = "/api/v1/tema/library/collections/" + std::to_string(collection_ids[std::stoi(coll_id) - 1])
-                        + "/movies/" + std::to_string(movie_ids[std::stoi(movie_id) - 1]);
+    std::string url = api_url("/library/collections/") + std::to_string(coll_server_id)
+                        + "/movies/" + std::to_string(movie_server_id);
 
-    std::string request = compute_delete_request(HOST, url, {}, jwt_token);
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_delete_request(config.host, url, *session.header_block(AUTH_JWT));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "delete movie from collection");
     else print_success("Movie deleted from collection successfully.");
 }
 
 void handle_logout() {
-    jwt_token.clear(); // Access to JWT token must be lost
-    if (user_cookie.empty()) {
+    session.clear_jwt_token(); // Access to JWT token must be lost
+    if (!session.user_logged_in()) {
         print_error("User not logged in. Nothing to logout from.");
         return;
     }
 
-    std::string request = compute_get_request(HOST, "/api/v1/tema/user/logout", "", {user_cookie}, "");
-    HttpResponse res = send_request_get_reply(sockfd, request);
+    std::string request = compute_get_request(config.host, api_url("/user/logout"), "", *session.header_block(AUTH_USER_COOKIE));
+    HttpResponse res = server->send(request);
 
     if (res.is_error()) build_error_message(res, "logout");
     else print_success("User logged out successfully.");
 
-    user_cookie.clear();
+    session.clear_user_cookie();
 }
\ No newline at end of file
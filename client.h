@@ -25,10 +25,43 @@ void handle_logout();
 // Helpers
 void close_server_connection();
 
+// Full path of an API route, e.g. "/library/movies" under the configured base path
+std::string api_url(const std::string& route);
+
+// Parses a line of 1-based indexes separated by spaces; false if it is
+// empty or holds anything but numbers
+bool read_indexes(const std::string& line, std::vector<int>& indexes);
+
+// The worker pool, started on first use with config.workers threads
+WorkerPool& worker_pool();
+
+// Sends independent read-only requests in parallel over the worker pool's
+// connections (a single one over the shared connection) and returns the
+// responses in request order
+std::vector<HttpResponse> send_parallel(std::vector<std::string> requests);
+
+// Print the details of one get_movie / get_collection reply, or its error
+void print_movie(const HttpResponse& res, const std::string& movie_id);
+void print_collection(const HttpResponse& res, int coll_id);
+
+// POST /collections/{id}/movies request for each server movie ID, and the
+// report (by the indexes the user typed) of those the server refused
+std::vector<HttpRequest> collection_movie_requests(int coll_id, const std::vector<int>& movie_ids);
+void report_collection_movies(const std::vector<int>& ids, const std::vector<HttpResponse>& responses);
+
+// Sends a listing request and prints "#<n><separator><title>" for each
+// object of the list_key list in the reply while the body is still
+// arriving, without parsing it into a json document. A successful reply
+// that turns out truncated or malformed is reported as a failure of
+// command_name.
+HttpResponse stream_titles(const std::string& request, const std::string& list_key,
+                           const std::string& heading, const std::string& separator,
+                           const std::string& command_name);
+
 // Check if credentials given by user are valid
 bool validate_credentials(const std::string &username, const std::string &password);
 
 // Print error message received from server
-void build_error_message(HttpResponse response, const std::string &command_name);
+void build_error_message(const HttpResponse& response, const std::string &command_name);
 
 #endif
\ No newline at end of file
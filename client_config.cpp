@@ -0,0 +1,122 @@
+#include "client_config.h"
+#include "helpers.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+// Keys that can also be set from $HTTP_CLIENT_<KEY>
+static const char* const client_keys[] = {
+    "host", "port", "base_path", "endpoints", "balance", "workers", "transport", "connect_timeout", "read_timeout", "write_timeout",
+    "socket_config",
+};
+
+static bool parse_int(const std::string& value, int min, int max, int& out) {
+    char* end = nullptr;
+    long parsed = strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || parsed < min || parsed > max) return false;
+    out = (int)parsed;
+    return true;
+}
+
+bool set_client_option(ClientConfig& config, const std::string& key, const std::string& value,
+                       std::string& error_msg) {
+    bool ok = true;
+    if (key == "host") {
+        config.host = value;
+        ok = !value.empty();
+    } else if (key == "port") {
+        ok = parse_int(value, 1, 65535, config.port);
+    } else if (key == "base_path") {
+        // "/api/v1/tema", "api/v1/tema/" and "" (routes at the root) all work
+        std::string path = value;
+        while (!path.empty() && path.back() == '/') path.pop_back();
+        if (!path.empty() && path[0] != '/') path = "/" + path;
+        config.base_path = path;
+    } else if (key == "endpoints") {
+        std::vector<Endpoint> endpoints;
+        config.endpoints = value;
+        ok = value.empty() || parse_endpoints(value, config.port, endpoints);
+    } else if (key == "balance") {
+        ok = parse_balance_policy(value, config.balance);
+    } else if (key == "workers") {
+        ok = parse_int(value, 1, 256, config.workers);
+    } else if (key == "transport") {
+        ok = parse_transport(value, config.transport);
+    } else if (key == "connect_timeout") {
+        ok = parse_int(value, 0, 3600000, config.timeouts.connect_ms);
+    } else if (key == "read_timeout") {
+        ok = parse_int(value, 0, 3600000, config.timeouts.read_ms);
+    } else if (key == "write_timeout") {
+        ok = parse_int(value, 0, 3600000, config.timeouts.write_ms);
+    } else if (key == "socket_config") {
+        return load_socket_profile(value, config.socket_profile, error_msg);
+    } else if (!set_socket_option(config.socket_profile, key, value)) {
+        error_msg = "Unknown option or bad value: " + key + "=" + value;
+        return false;
+    }
+
+    if (!ok) {
+        error_msg = "Bad value for " + key + ": " + value;
+    }
+    return ok;
+}
+
+bool load_client_config(int argc, char* argv[], ClientConfig& config, std::string& error_msg) {
+    std::string config_file = getenv("HTTP_CLIENT_CONFIG") ? getenv("HTTP_CLIENT_CONFIG") : "";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--config=", 0) == 0) config_file = arg.substr(strlen("--config="));
+    }
+
+    if (!config_file.empty()) {
+        std::string option_error;
+        bool loaded = read_config_file(config_file, [&](const std::string& key, const std::string& value) {
+            return set_client_option(config, key, value, option_error);
+        }, error_msg);
+        if (!loaded) {
+            if (!option_error.empty()) error_msg += " (" + option_error + ")";
+            return false;
+        }
+    }
+
+    for (const char* key : client_keys) {
+        std::string name = "HTTP_CLIENT_" + std::string(key);
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        const char* value = getenv(name.c_str());
+        if (value && !set_client_option(config, key, value, error_msg)) {
+            error_msg = name + ": " + error_msg;
+            return false;
+        }
+    }
+    apply_socket_env(config.socket_profile, config.warnings);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || equals == std::string::npos) {
+            error_msg = "Expected --<option>=<value>, got " + arg;
+            return false;
+        }
+        std::string key = arg.substr(2, equals - 2);
+        std::replace(key.begin(), key.end(), '-', '_');
+        if (key != "config" && !set_client_option(config, key, arg.substr(equals + 1), error_msg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<LoadBalancer> make_load_balancer(const ClientConfig& config) {
+    std::vector<Endpoint> endpoints;
+    if (config.endpoints.empty() || !parse_endpoints(config.endpoints, config.port, endpoints)) {
+        endpoints = {{config.host, config.port}};
+    }
+    return std::make_shared<LoadBalancer>(endpoints, config.balance);
+}
+
+void apply_client_config(const ClientConfig& config) {
+    set_transport(config.transport);
+    set_net_timeouts(config.timeouts);
+    set_socket_profile(config.socket_profile);
+}
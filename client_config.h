@@ -0,0 +1,54 @@
+#ifndef CLIENT_CONFIG_H
+#define CLIENT_CONFIG_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "http_requests.h"
+#include "socket_options.h"
+#include "load_balancer.h"
+
+// Used when nothing else is configured
+#define DEFAULT_HOST "63.32.125.183"
+#define DEFAULT_PORT 8081
+#define DEFAULT_BASE_PATH "/api/v1/tema"
+#define DEFAULT_WORKERS 4
+
+// Where the client connects and how, decided at startup
+struct ClientConfig {
+    std::string host = DEFAULT_HOST;     // Also sent as the Host header
+    int port = DEFAULT_PORT;
+    std::string base_path = DEFAULT_BASE_PATH; // Prefix of every API route
+    std::string endpoints;               // "host:port,..." replicas; empty: just host:port
+    BalancePolicy balance = BALANCE_ROUND_ROBIN;
+    int workers = DEFAULT_WORKERS;       // Threads (and connections) for parallel reads
+    Transport transport = TRANSPORT_SYSCALLS;
+    NetTimeouts timeouts;
+    SocketProfile socket_profile;
+    std::vector<std::string> warnings;   // Settings that were ignored, to be reported
+};
+
+// Sets one option by key: host, port, base_path, endpoints, balance
+// (round_robin, least_outstanding or p2c), workers, transport, connect_timeout,
+// read_timeout, write_timeout (ms), socket_config (a socket option file) or
+// any socket option key (socket_options.h). False for an unknown key or a
+// bad value.
+bool set_client_option(ClientConfig& config, const std::string& key, const std::string& value,
+                       std::string& error_msg);
+
+// Fills config from, lowest priority first: the defaults, a config file
+// (--config=<file> or $HTTP_CLIENT_CONFIG) of "key = value" lines, the
+// environment ($HTTP_CLIENT_<KEY>, e.g. HTTP_CLIENT_BASE_PATH) and command
+// line flags (--<key>=<value>, dashes or underscores, e.g. --base-path=).
+// Returns false with a message in error_msg on a bad option; bad socket
+// option variables are only skipped, with a message in config.warnings.
+bool load_client_config(int argc, char* argv[], ClientConfig& config, std::string& error_msg);
+
+// The balancer over config's endpoints (or host:port alone); endpoints
+// without a port use config.port
+std::shared_ptr<LoadBalancer> make_load_balancer(const ClientConfig& config);
+
+// Makes the transport, timeouts and socket profile of config the active ones
+void apply_client_config(const ClientConfig& config);
+
+#endif // CLIENT_CONFIG_H
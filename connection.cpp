@@ -0,0 +1,248 @@
+#include "connection.h"
+#include <algorithm>
+
+static std::string pool_key(const std::string& host, int port) {
+    return host + ":" + std::to_string(port);
+}
+
+static HttpResponse failed_response(NetError error) {
+    HttpResponse response;
+    response.net_error = error;
+    return response;
+}
+
+ConnectionPool::ConnectionPool(size_t max_connections, std::chrono::milliseconds max_idle)
+    : max_connections(max_connections), max_idle(max_idle) {}
+
+ConnectionPool::~ConnectionPool() {
+    clear();
+}
+
+int ConnectionPool::acquire(const std::string& host, int port, bool& reused, NetError* error) {
+    std::unique_lock<std::mutex> guard(lock);
+    HostEntry& entry = hosts[pool_key(host, port)];
+    auto now = std::chrono::steady_clock::now();
+
+    while (!entry.idle.empty()) {
+        IdleConnection conn = entry.idle.back();
+        entry.idle.pop_back();
+        if (now - conn.idle_since > max_idle || !is_connection_alive(conn.sockfd)) {
+            close_connection(conn.sockfd);
+            continue;
+        }
+        entry.in_use++;
+        hit_count++;
+        reused = true;
+        return conn.sockfd;
+    }
+
+    if (entry.in_use >= max_connections) {
+        if (error) *error = NET_NO_CONNECTION;
+        return -1;
+    }
+    entry.in_use++;
+    miss_count++;
+    reused = false;
+    guard.unlock(); // Don't hold the pool while connecting
+
+    int sockfd = open_connection(host.c_str(), port, error);
+    if (sockfd < 0) {
+        guard.lock();
+        entry.in_use--;
+    }
+    return sockfd;
+}
+
+void ConnectionPool::release(const std::string& host, int port, int sockfd, bool reusable) {
+    std::lock_guard<std::mutex> guard(lock);
+    HostEntry& entry = hosts[pool_key(host, port)];
+    if (entry.in_use > 0) {
+        entry.in_use--;
+    }
+
+    if (!reusable) {
+        close_connection(sockfd);
+        return;
+    }
+
+    // Drop sockets that expired while this one was in use
+    auto now = std::chrono::steady_clock::now();
+    size_t kept = 0;
+    for (const IdleConnection& conn : entry.idle) {
+        if (now - conn.idle_since > max_idle) close_connection(conn.sockfd);
+        else entry.idle[kept++] = conn;
+    }
+    entry.idle.resize(kept);
+    entry.idle.push_back({sockfd, now});
+}
+
+void ConnectionPool::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto& host_entry : hosts) {
+        for (const IdleConnection& conn : host_entry.second.idle) {
+            close_connection(conn.sockfd);
+        }
+        host_entry.second.idle.clear();
+    }
+}
+
+ConnectionManager::ConnectionManager(const std::string& host, int port)
+    : balancer(std::make_shared<LoadBalancer>(std::vector<Endpoint>{{host, port}})) {}
+
+ConnectionManager::ConnectionManager(std::shared_ptr<LoadBalancer> balancer)
+    : balancer(std::move(balancer)) {}
+
+void ConnectionManager::close() {
+    pool.clear();
+}
+
+HttpResponse ConnectionManager::send(const std::string& request_str) {
+    return send(request_str, std::string_view(), nullptr);
+}
+
+HttpResponse ConnectionManager::send(const HttpRequest& request) {
+    return send(request.head, request.body, nullptr);
+}
+
+HttpResponse ConnectionManager::send(const std::string& request_str, const BodySink& sink) {
+    return send(request_str, std::string_view(), &sink);
+}
+
+HttpResponse ConnectionManager::send(const HttpRequest& request, const BodySink& sink) {
+    return send(request.head, request.body, &sink);
+}
+
+HttpResponse ConnectionManager::send(std::string_view head, std::string_view body, const BodySink* sink) {
+    NetError error = NET_OK;
+    // Nothing was sent to an endpoint that could not be connected, so any
+    // request can move on to the next one
+    std::vector<size_t> tried;
+    for (size_t attempt = 0; attempt < balancer->size(); attempt++) {
+        size_t index = balancer->pick(tried);
+        tried.push_back(index);
+        auto started = std::chrono::steady_clock::now();
+        HttpResponse response;
+        bool connected = false;
+        error = send_to(balancer->endpoint(index), head, body, sink, response, connected);
+        balancer->finish(index, std::chrono::steady_clock::now() - started, error);
+        if (error == NET_OK) {
+            return response;
+        }
+        if (connected) {
+            break;
+        }
+    }
+    return failed_response(error);
+}
+
+NetError ConnectionManager::send_to(const Endpoint& endpoint, std::string_view head, std::string_view body,
+                                    const BodySink* sink, HttpResponse& response, bool& connected) {
+    const std::string& host = endpoint.host;
+    int port = endpoint.port;
+    bool reused = false;
+    NetError error = NET_OK;
+    int sockfd = pool.acquire(host, port, reused, &error);
+    if (sockfd < 0) {
+        return error;
+    }
+    connected = true;
+
+    // Whatever the sink already got can't be taken back
+    bool streamed = false;
+    BodySink counted_sink;
+    if (sink) {
+        counted_sink = [sink, &streamed](const char* data, size_t length) {
+            streamed = true;
+            (*sink)(data, length);
+        };
+    }
+
+    error = try_send_request(sockfd, head, body, response, sink ? &counted_sink : nullptr);
+    if (error != NET_OK) {
+        pool.release(host, port, sockfd, false);
+        // A reused connection may have been closed by the server while our
+        // request was in flight; only retry when sending it twice is harmless.
+        // A timeout is the server being slow, not a stale connection.
+        if (!reused || error != NET_CONNECTION_CLOSED || !is_idempotent_request(head) || streamed) {
+            return error;
+        }
+        sockfd = pool.acquire(host, port, reused, &error);
+        if (sockfd < 0) {
+            return error;
+        }
+        response = HttpResponse();
+        error = try_send_request(sockfd, head, body, response, sink);
+        if (error != NET_OK) {
+            pool.release(host, port, sockfd, false);
+            return error;
+        }
+    }
+
+    pool.release(host, port, sockfd, response.keep_alive);
+    return NET_OK;
+}
+
+static std::string_view request_head(const HttpRequest& request) { return request.head; }
+static std::string_view request_body(const HttpRequest& request) { return request.body; }
+static std::string_view request_head(const std::string& request) { return request; }
+static std::string_view request_body(const std::string&) { return std::string_view(); }
+
+template <typename Request>
+std::vector<HttpResponse> ConnectionManager::pipeline_with_fallback(const std::vector<Request>& requests,
+                                                                    size_t window) {
+    std::vector<HttpResponse> responses;
+    responses.reserve(requests.size());
+    if (requests.empty()) {
+        return responses;
+    }
+
+    // The whole batch goes to one endpoint; the fallback sends are balanced
+    PipelineProgress progress;
+    size_t index = balancer->pick();
+    const Endpoint& endpoint = balancer->endpoint(index);
+    auto started = std::chrono::steady_clock::now();
+    bool reused = false;
+    int sockfd = pool.acquire(endpoint.host, endpoint.port, reused, &progress.error);
+    if (sockfd >= 0) {
+        progress = ::send_pipelined(sockfd, requests, responses, window);
+        pool.release(endpoint.host, endpoint.port, sockfd,
+                     progress.answered == requests.size() && responses.back().keep_alive);
+    }
+    // Reported as the time per answered request, comparable with single sends
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    balancer->finish(index, elapsed / std::max<size_t>(progress.answered, 1), progress.error);
+
+    // A "Connection: close" reply means the server ignored what came after
+    // it; after an abrupt close, written requests may or may not have run.
+    // A server that timed out would most likely time out the rest one by
+    // one too, so they fail at once (unless another endpoint can be tried).
+    bool rest_ignored = progress.answered > 0 && !responses.back().keep_alive;
+    bool timed_out = progress.error == NET_WRITE_TIMEOUT || progress.error == NET_READ_TIMEOUT
+                     || (progress.error == NET_CONNECT_TIMEOUT && balancer->size() == 1);
+    responses.resize(requests.size());
+    for (size_t i = progress.answered; i < requests.size(); i++) {
+        bool unsafe_to_resend = i < progress.written && !rest_ignored && !is_idempotent_request(request_head(requests[i]));
+        if (timed_out || unsafe_to_resend) {
+            responses[i].net_error = progress.error;
+            continue;
+        }
+        responses[i] = send(request_head(requests[i]), request_body(requests[i]), nullptr);
+    }
+    return responses;
+}
+
+std::vector<HttpResponse> ConnectionManager::send_pipelined(const std::vector<HttpRequest>& requests,
+                                                            size_t window) {
+    return pipeline_with_fallback(requests, window);
+}
+
+std::vector<HttpResponse> ConnectionManager::send_pipelined(const std::vector<std::string>& requests,
+                                                            size_t window) {
+    return pipeline_with_fallback(requests, window);
+}
+
+bool is_idempotent_request(std::string_view request_str) {
+    std::string_view method = request_str.substr(0, request_str.find(' '));
+    return method == "GET" || method == "HEAD" || method == "PUT"
+        || method == "DELETE" || method == "OPTIONS";
+}
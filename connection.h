@@ -0,0 +1,111 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "http_requests.h"
+#include "load_balancer.h"
+
+// Idle keep-alive sockets kept for reuse, keyed by "host:port". Sockets are
+// checked for liveness before being handed out again, dropped after sitting
+// idle for too long, and at most max_connections are open per host.
+class ConnectionPool {
+public:
+    explicit ConnectionPool(size_t max_connections = 8,
+                            std::chrono::milliseconds max_idle = std::chrono::seconds(30));
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Returns a live idle socket to host:port (reused = true) or opens a new
+    // one. Returns -1 (reason in *error) if max_connections sockets to that
+    // host are in use or the connection could not be opened.
+    int acquire(const std::string& host, int port, bool& reused, NetError* error = nullptr);
+
+    // Hands a socket back; it is closed instead of kept when !reusable
+    void release(const std::string& host, int port, int sockfd, bool reusable);
+
+    // Closes every idle socket
+    void clear();
+
+    unsigned long hits() const { return hit_count; }
+    unsigned long misses() const { return miss_count; }
+
+private:
+    struct IdleConnection {
+        int sockfd;
+        std::chrono::steady_clock::time_point idle_since;
+    };
+
+    struct HostEntry {
+        std::vector<IdleConnection> idle; // Most recently used at the back
+        size_t in_use = 0;
+    };
+
+    size_t max_connections;
+    std::chrono::milliseconds max_idle;
+    std::mutex lock;
+    std::map<std::string, HostEntry> hosts;
+    std::atomic<unsigned long> hit_count{0};
+    std::atomic<unsigned long> miss_count{0};
+};
+
+// Keeps a keep-alive connection to the server open across commands.
+// When the server closes it (idle timeout, "Connection: close", EPIPE) the
+// manager reconnects, replaying the request if it is idempotent. With
+// several endpoints each request goes where the balancer says; one that
+// could not even connect is sent to another endpoint.
+class ConnectionManager {
+public:
+    ConnectionManager(const std::string& host, int port);
+    explicit ConnectionManager(std::shared_ptr<LoadBalancer> balancer);
+
+    // Sends the request on an open connection (connecting first if needed).
+    // Returns a response with status_code 0 and net_error set if no reply
+    // could be obtained.
+    HttpResponse send(const std::string& request_str);
+    HttpResponse send(const HttpRequest& request);
+
+    // Same, but the body of a 2xx reply goes to sink as it arrives (see
+    // BodySink). A request is not replayed once part of its body was passed on.
+    HttpResponse send(const std::string& request_str, const BodySink& sink);
+    HttpResponse send(const HttpRequest& request, const BodySink& sink);
+
+    // Pipelines the requests on one connection, at most window in flight.
+    // If the server closes it part way, the rest are sent one at a time
+    // (except non-idempotent requests that may already have been processed);
+    // after a timeout the rest fail straight away instead of waiting again.
+    // Returns one response per request, in order; status_code 0 on failure.
+    std::vector<HttpResponse> send_pipelined(const std::vector<HttpRequest>& requests,
+                                             size_t window = PIPELINE_WINDOW);
+    std::vector<HttpResponse> send_pipelined(const std::vector<std::string>& requests,
+                                             size_t window = PIPELINE_WINDOW);
+
+    // Closes the open connection(s)
+    void close();
+
+    const ConnectionPool& connection_pool() const { return pool; }
+    const LoadBalancer& load_balancer() const { return *balancer; }
+
+private:
+    std::shared_ptr<LoadBalancer> balancer;
+    ConnectionPool pool;
+
+    HttpResponse send(std::string_view head, std::string_view body, const BodySink* sink);
+    NetError send_to(const Endpoint& endpoint, std::string_view head, std::string_view body,
+                     const BodySink* sink, HttpResponse& response, bool& connected);
+
+    template <typename Request>
+    std::vector<HttpResponse> pipeline_with_fallback(const std::vector<Request>& requests, size_t window);
+};
+
+// GET, HEAD, PUT, DELETE and OPTIONS can be safely sent twice
+bool is_idempotent_request(std::string_view request_str);
+
+#endif // CONNECTION_H
@@ -0,0 +1,100 @@
+#include "coro_requests.h"
+
+#ifdef HTTP_CLIENT_COROUTINES
+
+Task& Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+Task::~Task() {
+    if (handle) {
+        handle.destroy();
+    }
+}
+
+std::coroutine_handle<> Task::await_suspend(std::coroutine_handle<> awaiting) {
+    handle.promise().continuation = awaiting;
+    return handle; // Symmetric transfer into the task
+}
+
+void Task::await_resume() {
+    if (handle && handle.promise().exception) {
+        std::rethrow_exception(handle.promise().exception);
+    }
+}
+
+void CoroScheduler::spawn(Task task) {
+    std::coroutine_handle<Task::promise_type> handle = task.handle;
+    tasks.push_back(std::move(task));
+    handle.resume(); // Runs up to its first co_await
+}
+
+// Both notify under the lock: once run() can see the work it may return
+// and the scheduler be destroyed, condition variable included
+void CoroScheduler::post(std::function<void()> work) {
+    std::lock_guard<std::mutex> guard(lock);
+    ready.push_back(std::move(work));
+    work_ready.notify_one();
+}
+
+void CoroScheduler::start_request() {
+    std::lock_guard<std::mutex> guard(lock);
+    in_flight++;
+}
+
+void CoroScheduler::finish_request(std::function<void()> completion) {
+    std::lock_guard<std::mutex> guard(lock);
+    in_flight--;
+    ready.push_back(std::move(completion));
+    work_ready.notify_one();
+}
+
+void CoroScheduler::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        work_ready.wait(guard, [this] { return !ready.empty() || in_flight == 0; });
+        if (ready.empty()) break;
+        std::function<void()> work = std::move(ready.front());
+        ready.pop_front();
+        guard.unlock();
+        work(); // May start requests and post more work
+        guard.lock();
+    }
+    guard.unlock();
+
+    std::exception_ptr first_exception;
+    for (Task& task : tasks) {
+        if (!first_exception && task.done() && task.handle && task.handle.promise().exception) {
+            first_exception = task.handle.promise().exception;
+        }
+    }
+    tasks.clear();
+    if (first_exception) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+void RequestAwaitable::await_suspend(std::coroutine_handle<> awaiting) {
+    // Counted before submitting, so run() can't stop before the reply
+    scheduler.start_request();
+    scheduler.workers().submit(std::move(request), [this, awaiting](HttpResponse& result) {
+        response = std::move(result);
+        scheduler.finish_request([awaiting] { awaiting.resume(); });
+    });
+}
+
+void RequestBatchAwaitable::await_suspend(std::coroutine_handle<> awaiting) {
+    // Sent from run(), not from here, so the coroutine is resumed after
+    // await_suspend has returned
+    scheduler.post([this, awaiting] {
+        responses = scheduler.connection().send_pipelined(requests);
+        awaiting.resume();
+    });
+}
+
+#endif // HTTP_CLIENT_COROUTINES
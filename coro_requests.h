@@ -0,0 +1,158 @@
+#ifndef CORO_REQUESTS_H
+#define CORO_REQUESTS_H
+
+// C++20 coroutine layer over the client's shared ConnectionManager and its
+// WorkerPool. Only available when building with
+// coroutine support (make STD=c++20); the C++17 build leaves it out and
+// HTTP_CLIENT_COROUTINES undefined.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define HTTP_CLIENT_COROUTINES 1
+
+#include <coroutine>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "connection.h"
+#include "worker_pool.h"
+
+// Lazily started coroutine returning nothing. Either co_await it from
+// another coroutine or hand it to CoroScheduler::spawn.
+class Task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // Hands control back to whoever awaited the task
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task& operator=(Task&& other) noexcept;
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task();
+
+    bool done() const { return !handle || handle.done(); }
+
+    // co_await task: starts it and resumes the caller once it finishes
+    bool await_ready() const { return done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting);
+    void await_resume();
+
+private:
+    friend class CoroScheduler;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Single-threaded scheduler: spawned tasks run until they co_await a
+// request and are resumed from run(), on the thread that called it, once
+// the request is answered. Single requests go to the worker pool, so those
+// of several tasks are in flight at once; batches are pipelined on the
+// shared connection, which only the scheduler's thread touches.
+class CoroScheduler {
+public:
+    CoroScheduler(ConnectionManager& connection, WorkerPool& workers)
+        : shared_connection(connection), pool(workers) {}
+
+    ConnectionManager& connection() { return shared_connection; }
+    WorkerPool& workers() { return pool; }
+
+    // Starts the task; it keeps running from run()
+    void spawn(Task task);
+
+    // Runs until every spawned task has finished, rethrowing the first
+    // exception one of them ended with
+    void run();
+
+    // Queues work for run(). Any thread may call it.
+    void post(std::function<void()> work);
+
+    // Marks a request answered on another thread; run() keeps waiting until
+    // its completion is posted with finish_request
+    void start_request();
+    void finish_request(std::function<void()> completion);
+
+private:
+    ConnectionManager& shared_connection;
+    WorkerPool& pool;
+    std::vector<Task> tasks;
+
+    std::mutex lock;
+    std::condition_variable work_ready;
+    std::deque<std::function<void()>> ready;
+    size_t in_flight = 0; // Started requests not finished yet
+};
+
+// co_await async_send_request(scheduler, request) -> HttpResponse, sent by
+// a pool worker. The coroutine is never resumed inside await_suspend, even
+// if the response arrives before it returns: run() does it.
+class RequestAwaitable {
+public:
+    RequestAwaitable(CoroScheduler& scheduler, HttpRequest request)
+        : scheduler(scheduler), request(std::move(request)) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> awaiting);
+    HttpResponse await_resume() { return std::move(response); }
+
+private:
+    CoroScheduler& scheduler;
+    HttpRequest request;
+    HttpResponse response;
+};
+
+// co_await async_send_all(scheduler, requests) -> responses in request
+// order, pipelined on the shared connection (ConnectionManager::send_pipelined)
+class RequestBatchAwaitable {
+public:
+    RequestBatchAwaitable(CoroScheduler& scheduler, std::vector<HttpRequest> requests)
+        : scheduler(scheduler), requests(std::move(requests)) {}
+
+    bool await_ready() const { return requests.empty(); }
+    void await_suspend(std::coroutine_handle<> awaiting);
+    std::vector<HttpResponse> await_resume() { return std::move(responses); }
+
+private:
+    CoroScheduler& scheduler;
+    std::vector<HttpRequest> requests;
+    std::vector<HttpResponse> responses;
+};
+
+inline RequestAwaitable async_send_request(CoroScheduler& scheduler, HttpRequest request) {
+    return RequestAwaitable(scheduler, std::move(request));
+}
+
+inline RequestAwaitable async_send_request(CoroScheduler& scheduler, std::string request_str) {
+    HttpRequest request;
+    request.head = std::move(request_str);
+    return RequestAwaitable(scheduler, std::move(request));
+}
+
+inline RequestBatchAwaitable async_send_all(CoroScheduler& scheduler, std::vector<HttpRequest> requests) {
+    return RequestBatchAwaitable(scheduler, std::move(requests));
+}
+
+#endif // coroutine support
+
+#endif // CORO_REQUESTS_H
@@ -0,0 +1,171 @@
+#include "header_scan.h"
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEADER_SCAN_X86 1
+#endif
+
+#define BLOCK_SIZE 64
+
+// One bit per byte of word equal to c, in byte order (8 bytes at a time in
+// a plain register: the exact zero-byte test, then the high bits gathered
+// with a multiply)
+static uint64_t match_bytes(uint64_t word, uint64_t c) {
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t x = word ^ (c * 0x0101010101010101ULL);
+    uint64_t zero = ~(((x & low7) + low7) | x | low7);
+    return ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+static void classify_scalar(const char* data, size_t blocks, uint64_t* lines, uint64_t* colons) {
+    for (size_t b = 0; b < blocks; b++) {
+        const char* block = data + BLOCK_SIZE * b;
+        uint64_t block_lines = 0;
+        uint64_t block_colons = 0;
+        for (int i = 0; i < BLOCK_SIZE / 8; i++) {
+            uint64_t word;
+            memcpy(&word, block + 8 * i, 8);
+            if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) {
+                word = __builtin_bswap64(word);
+            }
+            block_lines |= match_bytes(word, '\n') << (8 * i);
+            block_colons |= match_bytes(word, ':') << (8 * i);
+        }
+        lines[b] = block_lines;
+        colons[b] = block_colons;
+    }
+}
+
+#if defined(HEADER_SCAN_X86)
+__attribute__((target("sse2")))
+static void classify_sse2(const char* data, size_t blocks, uint64_t* lines, uint64_t* colons) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i colon = _mm_set1_epi8(':');
+    for (size_t b = 0; b < blocks; b++) {
+        const char* block = data + BLOCK_SIZE * b;
+        uint64_t block_lines = 0;
+        uint64_t block_colons = 0;
+        for (int i = 0; i < BLOCK_SIZE / 16; i++) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+            block_lines |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)) << (16 * i);
+            block_colons |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, colon)) << (16 * i);
+        }
+        lines[b] = block_lines;
+        colons[b] = block_colons;
+    }
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char* data, size_t blocks, uint64_t* lines, uint64_t* colons) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i colon = _mm256_set1_epi8(':');
+    for (size_t b = 0; b < blocks; b++) {
+        const char* block = data + BLOCK_SIZE * b;
+        __m256i low = _mm256_loadu_si256((const __m256i*)block);
+        __m256i high = _mm256_loadu_si256((const __m256i*)(block + 32));
+        lines[b] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline))
+                 | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)) << 32;
+        colons[b] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, colon))
+                  | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, colon)) << 32;
+    }
+}
+#endif
+
+static bool isa_supported(ScanIsa isa) {
+    if (isa == SCAN_MEMCHR) return true;
+#if defined(HEADER_SCAN_X86)
+    __builtin_cpu_init();
+    if (isa == SCAN_AVX2) return __builtin_cpu_supports("avx2");
+    if (isa == SCAN_SSE2) return __builtin_cpu_supports("sse2");
+#endif
+    return isa == SCAN_SCALAR;
+}
+
+static ClassifyFn classifier_for(ScanIsa isa) {
+    if (isa == SCAN_MEMCHR) return nullptr;
+#if defined(HEADER_SCAN_X86)
+    if (isa == SCAN_AVX2) return classify_avx2;
+    if (isa == SCAN_SSE2) return classify_sse2;
+#endif
+    return classify_scalar;
+}
+
+static ScanIsa best_isa() {
+    return isa_supported(SCAN_AVX2) ? SCAN_AVX2 : SCAN_MEMCHR;
+}
+
+// Chosen on first use, before any parsing
+static std::atomic<ScanIsa>& active_isa() {
+    static std::atomic<ScanIsa> isa(best_isa());
+    return isa;
+}
+
+static std::atomic<ClassifyFn>& active_classifier() {
+    static std::atomic<ClassifyFn> classifier(classifier_for(active_isa()));
+    return classifier;
+}
+
+ScanIsa get_scan_isa() {
+    return active_isa();
+}
+
+bool set_scan_isa(ScanIsa isa) {
+    if (!isa_supported(isa)) {
+        return false;
+    }
+    active_isa() = isa;
+    active_classifier() = classifier_for(isa);
+    return true;
+}
+
+const char* scan_isa_name(ScanIsa isa) {
+    switch (isa) {
+    case SCAN_AVX2: return "avx2";
+    case SCAN_SSE2: return "sse2";
+    case SCAN_SCALAR: return "scalar";
+    default: return "memchr";
+    }
+}
+
+DelimiterScanner::DelimiterScanner(const char* data, size_t length)
+    : data(data), length(length), classify(active_classifier().load(std::memory_order_relaxed)) {}
+
+void DelimiterScanner::load_window() {
+    block_start = next_window;
+    size_t remaining = length - next_window;
+    size_t full = std::min(remaining / BLOCK_SIZE, (size_t)SCAN_WINDOW_BLOCKS);
+    classify(data + next_window, full, window_lines, window_colons);
+    window_size = full;
+    next_window += full * BLOCK_SIZE;
+    if (full < SCAN_WINDOW_BLOCKS && next_window < length) {
+        // Last, shorter block: zero padding holds no delimiters
+        char tail[BLOCK_SIZE] = {};
+        memcpy(tail, data + next_window, length - next_window);
+        classify(tail, 1, window_lines + full, window_colons + full);
+        window_size++;
+        next_window = length;
+    }
+    window_pos = 0;
+}
+
+size_t DelimiterScanner::next_line_memchr(size_t& colon) {
+    colon = std::string_view::npos;
+    if (next_window >= length) {
+        return std::string_view::npos;
+    }
+    const char* start = data + next_window;
+    const char* newline = (const char*)memchr(start, '\n', length - next_window);
+    size_t line_length = newline ? (size_t)(newline - start) : length - next_window;
+    const char* found = (const char*)memchr(start, ':', line_length);
+    if (found) {
+        colon = found - data;
+    }
+    if (!newline) {
+        next_window = length; // colon belongs to the unfinished last line
+        return std::string_view::npos;
+    }
+    next_window += line_length + 1;
+    return newline - data;
+}
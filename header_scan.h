@@ -0,0 +1,97 @@
+#ifndef HEADER_SCAN_H
+#define HEADER_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-byte blocks classified per call: one dispatch covers a typical header
+// block
+#define SCAN_WINDOW_BLOCKS 4
+
+// Ways the delimiter scan can run. At startup AVX2 is picked if the CPU
+// has it, else memchr per line: in bench/header_scan_bench only AVX2 keeps
+// up with libc's memchr, the SSE2 and plain C++ (eight bytes at a time)
+// classifiers are slower and only used when set_scan_isa() asks for them.
+enum ScanIsa { SCAN_MEMCHR, SCAN_SCALAR, SCAN_SSE2, SCAN_AVX2 };
+
+ScanIsa get_scan_isa();
+
+// Forces an instruction set (for benchmarks); false if the CPU lacks it
+bool set_scan_isa(ScanIsa isa);
+
+// "memchr", "scalar", "sse2" or "avx2"
+const char* scan_isa_name(ScanIsa isa);
+
+// For each 64-byte block, sets bit i of lines[block] when byte i is '\n'
+// and of colons[block] when it is ':'
+typedef void (*ClassifyFn)(const char* data, size_t blocks, uint64_t* lines, uint64_t* colons);
+
+// Finds the line feeds and colons of a piece of an HTTP header block in
+// one pass: 64-byte blocks are turned into two bit masks with vector
+// compares, so lines and the name/value split of header lines are found
+// without going back over the bytes.
+class DelimiterScanner {
+public:
+    DelimiterScanner(const char* data, size_t length);
+
+    // Position of the next '\n', npos at the end; colon is set to the first
+    // ':' before it (since the previous line), npos if there is none. At the
+    // end colon belongs to the unfinished last line. Blocks are classified
+    // a window at a time as they are reached, so stopping at the end of the
+    // headers leaves most of the body untouched.
+    size_t next_line(size_t& colon) {
+        if (!classify) {
+            return next_line_memchr(colon);
+        }
+        colon = std::string_view::npos;
+        while (lines == 0) {
+            if (colon == std::string_view::npos && colons != 0) {
+                colon = block_start + __builtin_ctzll(colons);
+            }
+            if (!next_block()) {
+                return std::string_view::npos;
+            }
+        }
+        uint64_t line_end = lines & -lines;
+        uint64_t line_colons = colons & (line_end - 1);
+        if (colon == std::string_view::npos && line_colons != 0) {
+            colon = block_start + __builtin_ctzll(line_colons);
+        }
+        colons &= ~line_colons;
+        lines &= lines - 1;
+        return block_start + __builtin_ctzll(line_end);
+    }
+
+private:
+    const char* data;
+    size_t length;
+    ClassifyFn classify;    // nullptr: memchr per line
+    size_t next_window = 0; // First byte not classified (or searched) yet
+    size_t block_start = 0; // Offset of the current block
+    uint64_t window_lines[SCAN_WINDOW_BLOCKS];
+    uint64_t window_colons[SCAN_WINDOW_BLOCKS];
+    size_t window_size = 0;
+    size_t window_pos = 0;
+    uint64_t lines = 0;  // Line feeds of the current block not returned yet
+    uint64_t colons = 0; // Colons after the last returned line feed
+
+    bool next_block() {
+        if (window_pos + 1 < window_size) {
+            window_pos++;
+            block_start += 64;
+        } else if (next_window < length) {
+            load_window();
+        } else {
+            return false;
+        }
+        lines = window_lines[window_pos];
+        colons = window_colons[window_pos];
+        return true;
+    }
+
+    void load_window();
+    size_t next_line_memchr(size_t& colon);
+};
+
+#endif // HEADER_SCAN_H
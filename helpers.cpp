@@ -1,9 +1,9 @@
 #include "helpers.h"
+#include "http_parser.h"
 #include <cstdio>
+#include <fstream>
 #include <cstdlib>
 #include <cstring>
-#include <algorithm>
-#include <cctype>
 
 void error(const char *msg) {
     perror(msg);
@@ -17,80 +17,76 @@ std::string read_line_with_prompt(const std::string& prompt) {
     return line;
 }
 
-std::string get_cookie_value(const std::string& response, const std::string& cookie_name) {
-    std::string cookie_header_start = "Set-Cookie: ";
-    size_t start_pos = 0;
+// Runs a raw response string through the parser to get its header index
+static HttpResponse parse_raw_response(std::string_view response) {
+    ResponseParser parser;
+    parser.feed(response.data(), response.size());
+    parser.finish();
+    return parser.take_response();
+}
 
-    while ((start_pos = response.find(cookie_header_start, start_pos)) != std::string::npos) {
-        start_pos += cookie_header_start.length();
-        size_t end_pos = response.find(";", start_pos);
-        if (end_pos == std::string::npos) { // Cookie might be last part of header line
-            end_pos = response.find("\r\n", start_pos);
-        }
-        if (end_pos == std::string::npos) continue; // Should not happen
-
-        std::string cookie_full = response.substr(start_pos, end_pos - start_pos);
-        size_t name_end_pos = cookie_full.find("=");
-        if (name_end_pos != std::string::npos) {
-            std::string current_cookie_name = cookie_full.substr(0, name_end_pos);
-            if (current_cookie_name == cookie_name) {
-                return cookie_full; // Return "name=value"
-            }
+std::string get_cookie_value(const HttpResponse& response, const std::string& cookie_name) {
+    for (std::string_view cookie : response.header_values("Set-Cookie")) {
+        std::string_view name_value = cookie.substr(0, cookie.find(';')); // Drop the attributes
+        size_t name_end_pos = name_value.find('=');
+        if (name_end_pos != std::string_view::npos && name_value.substr(0, name_end_pos) == cookie_name) {
+            return std::string(name_value); // Return "name=value"
         }
     }
     return ""; // Cookie not found
 }
 
+std::string get_cookie_value(std::string_view response, const std::string& cookie_name) {
+    return get_cookie_value(parse_raw_response(response), cookie_name);
+}
+
 std::string extract_json_body(const std::string& response) {
-    size_t body_start = response.find("\r\n\r\n");
-    if (body_start == std::string::npos) {
-        return "";
+    HttpResponse parsed = parse_raw_response(response);
+    if (parsed.body_offset == 0) {
+        return ""; // Headers never ended
     }
 
-    body_start += 4; // Length of "\r\n\r\n"
-    std::string content_length_header = "Content-Length: ";
-    size_t content_length_pos = response.find(content_length_header);
-    if (content_length_pos == std::string::npos) {
-        // Try case-insensitive
-        std::string lower_response = response;
-        std::transform(lower_response.begin(), lower_response.end(), lower_response.begin(), ::tolower);
-        std::string lower_cl_header = "content-length: ";
-        content_length_pos = lower_response.find(lower_cl_header);
-        if (content_length_pos == std::string::npos) {
-            // If no Content-Length, try to find the first '{' or '['
-            size_t json_actual_start = response.find_first_of("{[", body_start);
-            if (json_actual_start != std::string::npos) {
-                return response.substr(json_actual_start);
-            }
-            return response.substr(body_start);
-        }
-        content_length_pos = response.find(content_length_header.substr(0,14), content_length_pos); // find original case "Content-Length: "
-    }
-    
-    if (content_length_pos != std::string::npos && content_length_pos < body_start) { // Ensure Content-Length is in headers
-        size_t content_length_value_start = content_length_pos + content_length_header.length();
-        size_t content_length_value_end = response.find("\r\n", content_length_value_start);
-        if (content_length_value_end != std::string::npos) {
-            int length = std::stoi(response.substr(content_length_value_start, content_length_value_end - content_length_value_start));
-            if (body_start + length <= response.length()) {
-                // Ensure the body actually starts with { or [ if expecting JSON
-                size_t json_actual_start = response.find_first_of("{[", body_start);
-                if (json_actual_start != std::string::npos && json_actual_start < body_start + 10) { // within first few chars
-                    return response.substr(json_actual_start, length - (json_actual_start - body_start));
-                }
-                return response.substr(body_start, length);
-            }
-        }
+    // Skip anything before the JSON: a few stray characters when the length
+    // is known, anything at all when it is not (shouldn't happen, safety measure)
+    std::string_view body = parsed.body();
+    size_t json_actual_start = body.find_first_of("{[");
+    if (json_actual_start != std::string_view::npos
+        && (json_actual_start < 10 || parsed.header("Content-Length").empty())) {
+        body.remove_prefix(json_actual_start);
     }
+    return std::string(body);
+}
 
-    // if Content-Length is missing , find the first '{' or '[' indicating
-    // start of JSON (this shouldn't happen, just a safety measure)
-    size_t json_actual_start = response.find_first_of("{[", body_start);
-    if (json_actual_start != std::string::npos) {
-        return response.substr(json_actual_start);
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(start, end - start + 1);
+}
+
+bool read_config_file(const std::string& path,
+                      const std::function<bool(const std::string& key, const std::string& value)>& setting,
+                      std::string& error_msg) {
+    std::ifstream file(path);
+    if (!file) {
+        error_msg = "Cannot open config file " + path;
+        return false;
     }
 
-    return response.substr(body_start);
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos || !setting(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+            error_msg = path + ":" + std::to_string(line_number) + ": invalid setting: " + line;
+            return false;
+        }
+    }
+    return true;
 }
 
 bool is_number(const std::string& s) {
@@ -108,4 +104,8 @@ void print_success(const std::string& message) {
 
 void print_error(const std::string& message) {
     std::cout << "ERROR: " << message << std::endl;
+}
+
+void print_warning(const std::string& message) {
+    std::cout << "WARNING: " << message << std::endl;
 }
\ No newline at end of file
@@ -2,12 +2,11 @@
 #define HELPERS_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
-
-// Server connection details
-#define HOST "63.32.125.183"
-#define PORT 8081
+#include <functional>
+#include "http_requests.h"
 
 #define BUFLEN 4096
 #define LINELEN 1000
@@ -18,18 +17,27 @@ void error(const char *msg);
 // Offers prompt and returns what the user has typed
 std::string read_line_with_prompt(const std::string& prompt);
 
-// Extract specific cookie value from HTTP response headers
-std::string get_cookie_value(const std::string& response, const std::string& cookie_name);
+// Extract specific cookie value ("name=value") from the Set-Cookie headers
+std::string get_cookie_value(const HttpResponse& response, const std::string& cookie_name);
+std::string get_cookie_value(std::string_view response, const std::string& cookie_name);
 
 // Extract JSON body from HTTP response
 std::string extract_json_body(const std::string& response);
 
+// Reads "key = value" lines (# starts a comment), passing each pair to
+// setting. Returns false with a message in error_msg if the file can't be
+// read or setting rejects a line.
+bool read_config_file(const std::string& path,
+                      const std::function<bool(const std::string& key, const std::string& value)>& setting,
+                      std::string& error_msg);
+
 // Basic input validation
 bool is_number(const std::string& s);
 
-// For ERROR or SUCCESS messages
+// For ERROR, WARNING or SUCCESS messages
 void print_success(const std::string& message);
 void print_error(const std::string& message);
+void print_warning(const std::string& message);
 
 
 #endif // HELPERS_H
\ No newline at end of file
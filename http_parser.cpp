@@ -0,0 +1,424 @@
+#include "http_parser.h"
+#include "socket_options.h"
+#include "header_scan.h"
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+#include <cctype>
+#include <charconv>
+#include <algorithm>
+
+static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+// Looks for a comma separated token, e.g. "close" in "Connection: close"
+static bool has_token(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (iequals(item, token)) return true;
+        if (comma == std::string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+size_t ResponseParser::feed(const char* data, size_t length) {
+    size_t pos = 0;
+    while (pos < length && state != DONE && state != FAILED) {
+        if (state == STATUS_LINE || state == HEADERS) {
+            pos += feed_headers(data + pos, length - pos);
+        } else if (state == BODY) {
+            size_t take = std::min(body_remaining, length - pos);
+            append_body(data + pos, take);
+            pos += take;
+            body_remaining -= take;
+            if (body_remaining == 0) {
+                state = DONE;
+            }
+        } else if (state == BODY_UNTIL_CLOSE) {
+            append_body(data + pos, length - pos);
+            pos = length;
+        } else {
+            pos += feed_chunked(data + pos, length - pos);
+        }
+    }
+    return pos;
+}
+
+// Status line and headers, a whole line at a time: one scan of the chunk
+// gives both the line ends and where each header name stops. Returns how
+// many bytes were used; scanning stops where the body starts.
+size_t ResponseParser::feed_headers(const char* data, size_t length) {
+    DelimiterScanner delimiters(data, length);
+    size_t pos = 0;
+    while (state == STATUS_LINE || state == HEADERS) {
+        size_t colon;
+        size_t found = delimiters.next_line(colon);
+        if (state == HEADERS && colon != std::string_view::npos && line_colon == std::string::npos) {
+            line_colon = buffer.size() + (colon - pos);
+        }
+        if (found == std::string_view::npos) {
+            buffer.append(data + pos, length - pos); // Rest of the line comes later
+            pos = length;
+            if (buffer.size() > MAX_HEADER_BYTES) {
+                state = FAILED;
+            }
+            break;
+        }
+        buffer.append(data + pos, found + 1 - pos);
+        pos = found + 1;
+        if (buffer.size() > MAX_HEADER_BYTES) {
+            state = FAILED;
+            break;
+        }
+        end_of_line();
+    }
+    return pos;
+}
+
+// Decodes chunked framing; returns how many bytes were used
+size_t ResponseParser::feed_chunked(const char* data, size_t length) {
+    size_t pos = 0;
+    while (pos < length && state != DONE && state != FAILED) {
+        char c = data[pos];
+        switch (state) {
+        case CHUNK_SIZE:
+            pos++;
+            if (c == '\n') {
+                if (!chunk_size_seen) {
+                    state = FAILED;
+                } else if (body_remaining == 0) {
+                    state = TRAILERS; // Last chunk
+                } else {
+                    state = CHUNK_DATA;
+                    if (!streaming) buffer.reserve(buffer.size() + body_remaining);
+                }
+            } else if (c == '\r' || in_chunk_extension) {
+                // Part of the line ending or of an ignored chunk extension
+            } else if (c == ';' || c == ' ' || c == '\t') {
+                in_chunk_extension = true;
+            } else if (isxdigit((unsigned char)c) && body_remaining < ((size_t)1 << 56)) {
+                int digit = isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10;
+                body_remaining = body_remaining * 16 + digit;
+                chunk_size_seen = true;
+            } else {
+                state = FAILED;
+            }
+            break;
+        case CHUNK_DATA: {
+            size_t take = std::min(body_remaining, length - pos);
+            append_body(data + pos, take);
+            pos += take;
+            body_remaining -= take;
+            if (body_remaining == 0) {
+                state = CHUNK_DATA_END;
+            }
+            break;
+        }
+        case CHUNK_DATA_END:
+            pos++;
+            if (c == '\n') {
+                state = CHUNK_SIZE;
+                chunk_size_seen = false;
+                in_chunk_extension = false;
+            } else if (c != '\r') {
+                state = FAILED;
+            }
+            break;
+        default: // TRAILERS, discarded up to the empty line
+            pos++;
+            if (c == '\n') {
+                if (trailer_line_length == 0) {
+                    state = DONE;
+                }
+                trailer_line_length = 0;
+            } else if (c != '\r') {
+                trailer_line_length++;
+            }
+            break;
+        }
+    }
+    return pos;
+}
+
+void ResponseParser::append_body(const char* data, size_t length) {
+    if (streaming) {
+        (*body_sink)(data, length);
+    } else {
+        buffer.append(data, length);
+    }
+}
+
+void ResponseParser::finish() {
+    if (state == BODY_UNTIL_CLOSE) {
+        state = DONE;
+    } else if (state != DONE) {
+        state = FAILED;
+    }
+}
+
+void ResponseParser::end_of_line() {
+    size_t line_end = buffer.size() - 1; // At the '\n'
+    if (line_end > line_start && buffer[line_end - 1] == '\r') {
+        line_end--;
+    }
+    std::string_view line(buffer.data() + line_start, line_end - line_start);
+
+    if (state == STATUS_LINE) {
+        if (!parse_status_line(line)) {
+            state = FAILED;
+            return;
+        }
+        state = HEADERS;
+    } else if (line.empty()) {
+        headers_end = last_line_end;
+        body_start = buffer.size();
+        headers_complete();
+        return;
+    } else if (line_colon == std::string::npos || !parse_header_line(line_start, line, line_colon - line_start)) {
+        state = FAILED;
+        return;
+    }
+    last_line_end = line_end;
+    line_start = buffer.size();
+    line_colon = std::string::npos;
+}
+
+bool ResponseParser::parse_status_line(std::string_view line) {
+    // HTTP/1.x SP 3DIGIT SP reason
+    if (line.size() < 12 || line.substr(0, 7) != "HTTP/1." || line[8] != ' ') {
+        return false;
+    }
+    http_minor = line[7] - '0';
+    auto result = std::from_chars(line.data() + 9, line.data() + 12, status_code);
+    return result.ec == std::errc() && result.ptr == line.data() + 12;
+}
+
+bool ResponseParser::parse_header_line(size_t offset, std::string_view line, size_t colon) {
+    if (colon == 0 || colon >= line.size()) {
+        return false;
+    }
+    size_t value_start = colon + 1;
+    size_t value_end = line.size();
+    while (value_start < value_end && (line[value_start] == ' ' || line[value_start] == '\t')) value_start++;
+    while (value_end > value_start && (line[value_end - 1] == ' ' || line[value_end - 1] == '\t')) value_end--;
+
+    header_fields.push_back({offset, colon, offset + value_start, value_end - value_start});
+    header_index.add(buffer, header_fields, (int)header_fields.size() - 1);
+    return true;
+}
+
+// FNV-1a over the lowercased name
+static uint32_t header_hash(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ (uint32_t)tolower((unsigned char)c)) * 16777619u;
+    }
+    return hash;
+}
+
+static std::string_view field_name(const std::string& buffer, const HeaderField& field) {
+    return std::string_view(buffer.data() + field.name_offset, field.name_length);
+}
+
+static std::string_view field_value(const std::string& buffer, const HeaderField& field) {
+    return std::string_view(buffer.data() + field.value_offset, field.value_length);
+}
+
+void HeaderIndex::add(const std::string& buffer, std::vector<HeaderField>& fields, int field) {
+    // Keep the table at most half full
+    if ((used + 1) * 2 > slots.size()) {
+        std::vector<Slot> old_slots = std::move(slots);
+        slots.assign(old_slots.empty() ? 16 : old_slots.size() * 2, Slot());
+        for (const Slot& slot : old_slots) {
+            if (slot.field < 0) continue;
+            size_t i = slot.hash & (slots.size() - 1);
+            while (slots[i].field >= 0) i = (i + 1) & (slots.size() - 1);
+            slots[i] = slot;
+        }
+    }
+
+    std::string_view name = field_name(buffer, fields[field]);
+    uint32_t hash = header_hash(name);
+    size_t i = hash & (slots.size() - 1);
+    while (slots[i].field >= 0) {
+        if (slots[i].hash == hash && iequals(field_name(buffer, fields[slots[i].field]), name)) {
+            // Repeated header, append to the chain for this name
+            int last = slots[i].field;
+            while (fields[last].next_same_name >= 0) last = fields[last].next_same_name;
+            fields[last].next_same_name = field;
+            return;
+        }
+        i = (i + 1) & (slots.size() - 1);
+    }
+    slots[i].hash = hash;
+    slots[i].field = field;
+    used++;
+}
+
+int HeaderIndex::find(const std::string& buffer, const std::vector<HeaderField>& fields,
+                      std::string_view name) const {
+    if (slots.empty()) return -1;
+    uint32_t hash = header_hash(name);
+    size_t i = hash & (slots.size() - 1);
+    while (slots[i].field >= 0) {
+        if (slots[i].hash == hash && iequals(field_name(buffer, fields[slots[i].field]), name)) {
+            return slots[i].field;
+        }
+        i = (i + 1) & (slots.size() - 1);
+    }
+    return -1;
+}
+
+std::string_view ResponseParser::header_value(std::string_view name) const {
+    int field = header_index.find(buffer, header_fields, name);
+    return field < 0 ? std::string_view() : field_value(buffer, header_fields[field]);
+}
+
+std::string_view HttpResponse::header(std::string_view name) const {
+    int field = header_index.find(buffer, header_fields, name);
+    return field < 0 ? std::string_view() : field_value(buffer, header_fields[field]);
+}
+
+std::vector<std::string_view> HttpResponse::header_values(std::string_view name) const {
+    std::vector<std::string_view> values;
+    for (int field = header_index.find(buffer, header_fields, name); field >= 0;
+         field = header_fields[field].next_same_name) {
+        values.push_back(field_value(buffer, header_fields[field]));
+    }
+    return values;
+}
+
+void ResponseParser::headers_complete() {
+    // Interim 1xx responses are followed by the real one
+    if (status_code >= 100 && status_code < 200 && status_code != 101) {
+        reset();
+        return;
+    }
+
+    std::string_view connection = header_value("Connection");
+    if (http_minor == 0) {
+        keep_alive = has_token(connection, "keep-alive");
+    } else {
+        keep_alive = !has_token(connection, "close");
+    }
+
+    if (status_code == 204 || status_code == 304) {
+        state = DONE;
+        return;
+    }
+    streaming = body_sink && status_code >= 200 && status_code < 300;
+
+    std::string_view transfer_encoding = header_value("Transfer-Encoding");
+    if (!transfer_encoding.empty()) {
+        size_t last_coding = transfer_encoding.rfind(',');
+        if (has_token(last_coding == std::string_view::npos ? transfer_encoding
+                                                            : transfer_encoding.substr(last_coding + 1),
+                      "chunked")) {
+            state = CHUNK_SIZE; // Chunked framing takes precedence over Content-Length
+            return;
+        }
+    }
+
+    std::string_view content_length = header_value("Content-Length");
+    if (!transfer_encoding.empty() || content_length.empty()) {
+        // No length to go by, the body ends when the server closes
+        keep_alive = false;
+        state = BODY_UNTIL_CLOSE;
+        return;
+    }
+
+    auto result = std::from_chars(content_length.data(), content_length.data() + content_length.size(), body_remaining);
+    if (result.ec != std::errc() || result.ptr != content_length.data() + content_length.size()) {
+        state = FAILED;
+        return;
+    }
+    if (!streaming) buffer.reserve(body_start + body_remaining);
+    state = body_remaining == 0 ? DONE : BODY;
+}
+
+HttpResponse ResponseParser::take_response() {
+    HttpResponse response;
+    response.status_code = status_code;
+    response.keep_alive = keep_alive && state == DONE;
+    response.buffer = std::move(buffer);
+    response.header_fields = std::move(header_fields);
+    response.header_index = std::move(header_index);
+    if (body_start > 0) {
+        response.headers_length = headers_end;
+        response.body_offset = body_start;
+    }
+    reset();
+    return response;
+}
+
+void ResponseParser::reset() {
+    state = STATUS_LINE;
+    buffer.clear();
+    line_start = 0;
+    line_colon = std::string::npos;
+    last_line_end = 0;
+    headers_end = 0;
+    body_start = 0;
+    body_remaining = 0;
+    chunk_size_seen = false;
+    in_chunk_extension = false;
+    trailer_line_length = 0;
+    status_code = 0;
+    http_minor = 1;
+    keep_alive = true;
+    streaming = false;
+    header_fields.clear();
+    header_index.clear();
+}
+
+ResponseReader::ResponseReader(int sockfd) : sockfd(sockfd) {}
+
+NetError ResponseReader::next(HttpResponse& response, const BodySink* sink) {
+    parser.set_body_sink(sink);
+    int timeout_ms = get_net_timeouts().read_ms;
+    Deadline deadline = deadline_after(timeout_ms);
+    while (true) {
+        // Bytes left over from the previous read may already hold the response
+        if (pending_start < pending_end) {
+            pending_start += parser.feed(buffer + pending_start, pending_end - pending_start);
+            if (parser.failed()) {
+                return NET_BAD_RESPONSE; // The connection can't be trusted
+            }
+        }
+        if (parser.done()) {
+            response = parser.take_response();
+            return NET_OK;
+        }
+
+        if (timeout_ms > 0 && !wait_for_socket(sockfd, POLLIN, remaining_ms(deadline))) {
+            return NET_READ_TIMEOUT;
+        }
+        rearm_quickack(sockfd);
+        ssize_t bytes = read(sockfd, buffer, BUFLEN);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == ECONNRESET ? NET_CONNECTION_CLOSED : NET_IO_ERROR;
+        }
+        if (bytes == 0) {
+            parser.finish(); // Completes a body delimited by the connection close
+            if (!parser.done()) {
+                return NET_CONNECTION_CLOSED; // Closed before answering
+            }
+            response = parser.take_response();
+            return NET_OK;
+        }
+        pending_start = 0;
+        pending_end = bytes;
+    }
+}
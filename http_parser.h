@@ -0,0 +1,93 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "http_requests.h"
+#include "helpers.h"
+
+// Upper bound for the status line + headers, to stop runaway responses
+#define MAX_HEADER_BYTES (64 * 1024)
+
+// Resumable HTTP/1.1 response parser: status line -> headers -> body.
+// Chunks are fed as they are read from the socket and every byte is looked
+// at once; line ends and header colons come from one pass (header_scan.h)
+// and their positions are recorded so nothing is rescanned.
+// A "Transfer-Encoding: chunked" body is decoded on the fly, only the chunk
+// payloads end up in the buffer.
+class ResponseParser {
+public:
+    enum State {
+        STATUS_LINE, HEADERS, BODY, BODY_UNTIL_CLOSE,
+        CHUNK_SIZE, CHUNK_DATA, CHUNK_DATA_END, TRAILERS,
+        DONE, FAILED
+    };
+
+    // Consumes a received chunk. Returns how many bytes belong to this
+    // response; the rest (if any) is the start of the next one.
+    size_t feed(const char* data, size_t length);
+
+    // The server closed the connection (completes a body without framing)
+    void finish();
+
+    // Where the body of the next 2xx responses goes instead of the buffer
+    // (nullptr: the buffer). The sink must outlive the parsing.
+    void set_body_sink(const BodySink* sink) { body_sink = sink; }
+
+    bool done() const { return state == DONE; }
+    bool failed() const { return state == FAILED; }
+
+    // Hands the buffer over to the response (no copy) and resets the parser
+    HttpResponse take_response();
+
+private:
+    State state = STATUS_LINE;
+    std::string buffer;              // Raw status line + headers, then the body
+    size_t line_start = 0;           // Start of the line currently being read
+    size_t line_colon = std::string::npos; // Its first ':', once seen
+    size_t last_line_end = 0;        // End of the previous line, without "\r\n"
+    size_t headers_end = 0;          // Where the "\r\n\r\n" separator starts
+    size_t body_start = 0;
+    size_t body_remaining = 0;       // Left of the body, or of the current chunk
+    bool chunk_size_seen = false;    // At least one hex digit in the size line
+    bool in_chunk_extension = false; // Skipping ";name=value" after the size
+    size_t trailer_line_length = 0;
+    int status_code = 0;
+    int http_minor = 1;
+    bool keep_alive = true;
+    std::vector<HeaderField> header_fields;
+    HeaderIndex header_index;
+    const BodySink* body_sink = nullptr;
+    bool streaming = false;          // This body goes to body_sink
+
+    void append_body(const char* data, size_t length);
+    void end_of_line();
+    size_t feed_headers(const char* data, size_t length);
+    size_t feed_chunked(const char* data, size_t length);
+    bool parse_status_line(std::string_view line);
+    bool parse_header_line(size_t offset, std::string_view line, size_t colon);
+    void headers_complete();
+    std::string_view header_value(std::string_view name) const;
+    void reset();
+};
+
+// Reads consecutive responses from one connection. Bytes read past the end
+// of a response are kept for the next one, as happens with pipelining.
+class ResponseReader {
+public:
+    explicit ResponseReader(int sockfd);
+
+    // Reads the next complete response, waiting at most the read timeout.
+    // A successful body goes to sink instead of the response when given.
+    NetError next(HttpResponse& response, const BodySink* sink = nullptr);
+
+private:
+    int sockfd;
+    ResponseParser parser;
+    char buffer[BUFLEN];
+    size_t pending_start = 0;
+    size_t pending_end = 0;
+};
+
+#endif // HTTP_PARSER_H
@@ -1,30 +1,139 @@
 #include "http_requests.h"
 #include "helpers.h"
+#include "http_parser.h"
+#include "request_builder.h"
+#include "uring_transport.h"
+#include "socket_options.h"
+#include "resolver.h"
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
-#include <arpa/inet.h>
 #include <netdb.h>
+#include <poll.h>
 #include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
-#include <sstream>
+#include <ostream>
+#include <streambuf>
 
-int open_connection (const char* host_ip, int portno) {
-    struct sockaddr_in serv_addr;
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        error("ERROR opening socket");
+static std::atomic<int> active_transport(TRANSPORT_SYSCALLS);
+
+Transport set_transport(Transport transport) {
+    if (transport == TRANSPORT_IO_URING && !thread_io_uring()) {
+        transport = TRANSPORT_SYSCALLS;
     }
+    active_transport = transport;
+    return transport;
+}
+
+Transport get_transport() {
+    return (Transport)active_transport.load();
+}
+
+bool parse_transport(const std::string& name, Transport& transport) {
+    if (name == "syscalls") transport = TRANSPORT_SYSCALLS;
+    else if (name == "io_uring") transport = TRANSPORT_IO_URING;
+    else return false;
+    return true;
+}
+
+static std::atomic<int> connect_timeout_ms(NetTimeouts().connect_ms);
+static std::atomic<int> read_timeout_ms(NetTimeouts().read_ms);
+static std::atomic<int> write_timeout_ms(NetTimeouts().write_ms);
+
+void set_net_timeouts(const NetTimeouts& timeouts) {
+    connect_timeout_ms = timeouts.connect_ms;
+    read_timeout_ms = timeouts.read_ms;
+    write_timeout_ms = timeouts.write_ms;
+}
 
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(portno);
-    if (inet_pton(AF_INET, host_ip, &serv_addr.sin_addr) <= 0) {
-        error("ERROR inet_pton");
+NetTimeouts get_net_timeouts() {
+    NetTimeouts timeouts;
+    timeouts.connect_ms = connect_timeout_ms;
+    timeouts.read_ms = read_timeout_ms;
+    timeouts.write_ms = write_timeout_ms;
+    return timeouts;
+}
+
+Deadline deadline_after(int timeout_ms) {
+    if (timeout_ms <= 0) {
+        return Deadline::max();
     }
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+}
 
-    if (connect(sockfd, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
-        error("ERROR connecting");
+int remaining_ms(Deadline deadline) {
+    if (deadline == Deadline::max()) {
+        return -1;
     }
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return left.count() > 0 ? (int)left.count() : 0;
+}
+
+const char* net_error_message(NetError error) {
+    switch (error) {
+    case NET_OK: return "no error";
+    case NET_RESOLVE_FAILED: return "could not resolve the server address";
+    case NET_CONNECT_FAILED: return "could not connect to the server";
+    case NET_CONNECT_TIMEOUT: return "timed out connecting to the server";
+    case NET_WRITE_TIMEOUT: return "timed out sending the request";
+    case NET_READ_TIMEOUT: return "timed out waiting for the response";
+    case NET_CONNECTION_CLOSED: return "connection closed by server";
+    case NET_BAD_RESPONSE: return "malformed response";
+    case NET_NO_CONNECTION: return "too many open connections";
+    case NET_IO_ERROR: return "socket error";
+    }
+    return "unknown error";
+}
+
+bool wait_for_socket(int sockfd, short events, int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = sockfd;
+    pfd.events = events;
+    while (true) {
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready > 0) return true;
+        if (ready == 0) return false;
+        if (errno != EINTR) return true; // Let the following read/write report it
+    }
+}
+
+// The thread's io_uring when that backend is selected
+static IoUring* selected_io_uring() {
+    return get_transport() == TRANSPORT_IO_URING ? thread_io_uring() : nullptr;
+}
+
+int open_connection (const char* host, int portno, NetError* error) {
+    NetError ignored;
+    if (!error) error = &ignored;
+
+    std::vector<ResolvedAddress> addresses;
+    if (!resolve_host(host, portno, addresses, error)) {
+        return -1;
+    }
+    int timeout_ms = connect_timeout_ms;
+
+    // io_uring connects a single address; several are raced with poll
+    IoUring* ring = selected_io_uring();
+    if (!ring || addresses.size() > 1) {
+        return happy_eyeballs_connect(addresses, timeout_ms, error);
+    }
+
+    const ResolvedAddress& address = addresses[0];
+    int sockfd = socket(address.family, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        *error = NET_IO_ERROR;
+        return -1;
+    }
+    apply_socket_profile(sockfd, get_socket_profile());
+    if (ring->connect(sockfd, (const struct sockaddr*)&address.addr, address.addr_len, timeout_ms) < 0) {
+        *error = errno == ETIMEDOUT ? NET_CONNECT_TIMEOUT : NET_CONNECT_FAILED;
+        close(sockfd);
+        return -1;
+    }
+    *error = NET_OK;
     return sockfd;
 }
 
@@ -32,136 +141,312 @@ void close_connection(int sockfd) {
     close(sockfd);
 }
 
-HttpResponse send_request_get_reply (int sockfd, const std::string& request_str) {
-    // Send message
-    int bytes, sent = 0;
-    int total = request_str.length();
-    do {
-        bytes = write(sockfd, request_str.c_str() + sent, total - sent);
-        if (bytes < 0) {
-            error("ERROR writing message to socket");
-        }
-        if (bytes == 0) {
-            break;
-        }
-        sent += bytes;
-    } while (sent < total);
+bool is_connection_alive(int sockfd) {
+    char probe;
+    ssize_t bytes = recv(sockfd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (bytes == 0) {
+        return false; // Orderly shutdown from the server
+    }
+    if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        return false;
+    }
+    return true;
+}
 
-    // Receive response
-    std::string response_str;
-    char buffer[BUFLEN];
-    int header_end_pos = -1;
-    unsigned long content_length = 0;
-    bool header_parsed = false;
+NetError send_fragments(int sockfd, const std::string_view* fragments, size_t count, size_t* sent) {
+    size_t ignored;
+    if (!sent) sent = &ignored;
+    *sent = 0;
 
-    // Read headers first
-    while (true) {
-        bytes = read(sockfd, buffer, BUFLEN - 1);
-        if (bytes < 0) {
-            error("ERROR reading response from socket");
-        }
-        if (bytes == 0) {
-            break;
+    // sendmsg is writev with flags (MSG_NOSIGNAL: a closed connection gives
+    // EPIPE instead of SIGPIPE). With a write timeout it doesn't block, and
+    // a full send buffer is waited out with poll until the deadline.
+    int timeout_ms = write_timeout_ms;
+    Deadline deadline = deadline_after(timeout_ms);
+    int flags = MSG_NOSIGNAL | (timeout_ms > 0 ? MSG_DONTWAIT : 0);
+
+    // At most MAX_FRAGMENTS pieces per sendmsg; longer lists take several rounds
+    size_t next = 0;
+    while (next < count) {
+        struct iovec iov[MAX_FRAGMENTS];
+        int iov_count = 0;
+        for (; next < count && iov_count < MAX_FRAGMENTS; next++) {
+            if (fragments[next].empty()) continue;
+            iov[iov_count].iov_base = (void*)fragments[next].data();
+            iov[iov_count].iov_len = fragments[next].size();
+            iov_count++;
         }
-        buffer[bytes] = '\0';
-        response_str.append(buffer, bytes);
-
-        header_end_pos = response_str.find("\r\n\r\n");
-        if (header_end_pos != -1) {
-            // Headers received, parse Content-Length
-            header_parsed = true;
-            std::string headers_part = response_str.substr(0, header_end_pos);
-            size_t content_length_pos = headers_part.find("Content-Length: ");
-             if (content_length_pos == std::string::npos) { // Try case insensitive for Content-Length
-                std::string lower_headers = headers_part;
-                std::transform(lower_headers.begin(), lower_headers.end(), lower_headers.begin(), ::tolower);
-                content_length_pos = lower_headers.find("content-length: ");
-                if (content_length_pos != std::string::npos) {
-                    // find original case start
-                    size_t original_content_length_pos = response_str.find(headers_part.substr(content_length_pos, 16));
-                    if(original_content_length_pos != std::string::npos) content_length_pos = original_content_length_pos; else content_length_pos = std::string::npos;
+
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        while (message.msg_iovlen > 0) {
+            ssize_t bytes = sendmsg(sockfd, &message, flags);
+            if (bytes < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // EINPROGRESS: TCP Fast Open without a cookie, the handshake
+                // has to finish first
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS) {
+                    if (!wait_for_socket(sockfd, POLLOUT, remaining_ms(deadline))) {
+                        return NET_WRITE_TIMEOUT;
+                    }
+                    continue;
+                }
+                if (errno == EPIPE || errno == ECONNRESET) {
+                    return NET_CONNECTION_CLOSED;
                 }
+                return NET_IO_ERROR;
             }
+            *sent += bytes;
 
-            if (content_length_pos != std::string::npos) {
-                size_t content_length_val_start = content_length_pos + strlen("Content-Length: ");
-                size_t content_length_val_end = headers_part.find("\r\n", content_length_val_start);
-                if (content_length_val_end != std::string::npos)
-                    content_length = std::stoul(headers_part.substr(content_length_val_start, content_length_val_end - content_length_val_start));
+            // Partial write: skip the fully sent vectors, trim the next one
+            size_t written = bytes;
+            while (message.msg_iovlen > 0 && written >= message.msg_iov->iov_len) {
+                written -= message.msg_iov->iov_len;
+                message.msg_iov++;
+                message.msg_iovlen--;
+            }
+            if (message.msg_iovlen > 0) {
+                message.msg_iov->iov_base = (char*)message.msg_iov->iov_base + written;
+                message.msg_iov->iov_len -= written;
             }
-            break; 
         }
     }
-    
-    // Read body based on Content-Length
-    if (header_parsed) {
-        size_t current_body_length = response_str.length() - (header_end_pos + 4);
-        while (current_body_length < content_length) {
-            bytes = read(sockfd, buffer, BUFLEN - 1);
-            if (bytes < 0) {
-                error("ERROR reading response body from socket");
+    return NET_OK;
+}
+
+NetError receive_response(int sockfd, HttpResponse& response, const BodySink* sink) {
+    ResponseReader reader(sockfd);
+    return reader.next(response, sink);
+}
+
+static std::string_view request_head(const HttpRequest& request) { return request.head; }
+static std::string_view request_body(const HttpRequest& request) { return request.body; }
+static std::string_view request_head(const std::string& request) { return request; }
+static std::string_view request_body(const std::string&) { return std::string_view(); }
+
+template <typename Request>
+static PipelineProgress pipeline_requests(int sockfd, const std::vector<Request>& requests,
+                                          std::vector<HttpResponse>& responses, size_t window) {
+    ResponseReader reader(sockfd);
+    PipelineProgress progress;
+    bool can_write = true;
+    if (window == 0) {
+        window = 1;
+    }
+
+    while (progress.answered < requests.size()) {
+        // Top up the window, several requests per writev
+        while (can_write && progress.written < requests.size() && progress.written - progress.answered < window) {
+            std::string_view fragments[MAX_FRAGMENTS];
+            size_t count = 0;
+            size_t batch_end = progress.written;
+            while (batch_end < requests.size() && batch_end - progress.answered < window && count + 2 <= MAX_FRAGMENTS) {
+                fragments[count++] = request_head(requests[batch_end]);
+                fragments[count++] = request_body(requests[batch_end]);
+                batch_end++;
             }
-            if (bytes == 0) {
+            size_t sent;
+            NetError error = send_fragments(sockfd, fragments, count, &sent);
+            if (error == NET_OK) {
+                progress.written = batch_end;
+                continue;
+            }
+            // A request that went out even in part may have reached the
+            // server, so it counts as written (and must not be resent unless
+            // it is idempotent)
+            for (size_t i = 0; progress.written < batch_end && sent > 0; i += 2) {
+                size_t length = fragments[i].size() + fragments[i + 1].size();
+                sent -= std::min(sent, length);
+                progress.written++;
+            }
+            if (error == NET_CONNECTION_CLOSED) {
+                progress.error = error;
+                can_write = false; // Still collect the replies to what went out
                 break;
             }
-            buffer[bytes] = '\0';
-            response_str.append(buffer, bytes);
-            current_body_length += bytes;
+            progress.error = error; // The connection can't be trusted any more
+            return progress;
+        }
+        if (progress.answered == progress.written) {
+            break; // Nothing in flight and nothing more can be sent
+        }
+
+        HttpResponse response;
+        NetError error = reader.next(response);
+        if (error != NET_OK) {
+            progress.error = error;
+            break;
+        }
+        bool keep_alive = response.keep_alive;
+        responses.push_back(std::move(response));
+        progress.answered++;
+        if (!keep_alive) {
+            break; // The server won't answer the rest on this connection
         }
     }
+    return progress;
+}
+
+PipelineProgress send_pipelined(int sockfd, const std::vector<HttpRequest>& requests,
+                                std::vector<HttpResponse>& responses, size_t window) {
+    return pipeline_requests(sockfd, requests, responses, window);
+}
 
+PipelineProgress send_pipelined(int sockfd, const std::vector<std::string>& requests,
+                                std::vector<HttpResponse>& responses, size_t window) {
+    return pipeline_requests(sockfd, requests, responses, window);
+}
 
+std::vector<HttpResponse> send_requests_pipelined(int sockfd, const std::vector<std::string>& requests,
+                                                  size_t window) {
+    std::vector<HttpResponse> responses;
+    responses.reserve(requests.size());
+    pipeline_requests(sockfd, requests, responses, window);
+    responses.resize(requests.size());
+    return responses;
+}
+
+NetError try_send_request(int sockfd, std::string_view head, std::string_view body, HttpResponse& response,
+                          const BodySink* sink) {
+    IoUring* ring = selected_io_uring();
+    if (ring) {
+        return ring->send_request(sockfd, head, body, response, sink);
+    }
+    std::string_view fragments[] = {head, body};
+    NetError error = send_fragments(sockfd, fragments, 2);
+    if (error != NET_OK) {
+        return error;
+    }
+    return receive_response(sockfd, response, sink);
+}
+
+NetError try_send_request(int sockfd, const std::string& request_str, HttpResponse& response) {
+    return try_send_request(sockfd, request_str, std::string_view(), response);
+}
+
+HttpResponse send_request_get_reply (int sockfd, const std::string& request_str) {
     HttpResponse response;
-    response.full_response = response_str;
-
-    // Status code parsing
-    size_t first_space = response_str.find(" ");
-    if (first_space != std::string::npos) {
-        size_t second_space = response_str.find(" ", first_space + 1);
-        if (second_space != std::string::npos) {
-            try {
-                response.status_code = std::stoi(response_str.substr(first_space + 1, second_space - (first_space + 1)));
-            } catch (const std::exception& e) {
-                response.status_code = 0; // Error parsing
-            }
+    NetError error = try_send_request(sockfd, request_str, response);
+    if (error != NET_OK) {
+        response = HttpResponse();
+        response.net_error = error;
+    }
+    return response;
+}
+
+
+// Rough serialized size of a JSON value from its string lengths and element
+// counts; walks the tree, not the text, so strings get an eighth extra for
+// escapes
+static size_t json_size_hint(const nlohmann::json& value) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::object: {
+        size_t size = 2;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            size += it.key().size() + 4 + json_size_hint(it.value()); // "key":value,
+        }
+        return size;
+    }
+    case nlohmann::json::value_t::array: {
+        size_t size = 2;
+        for (const nlohmann::json& element : value) {
+            size += json_size_hint(element) + 1;
         }
+        return size;
     }
-    
-    if (header_end_pos != -1) {
-        response.headers = response_str.substr(0, header_end_pos);
-        response.body = extract_json_body(response_str);
-    } else {
-        response.body = response_str;
+    case nlohmann::json::value_t::string:
+        return value.get_ref<const std::string&>().size() * 9 / 8 + 2;
+    case nlohmann::json::value_t::number_integer:
+        return std::to_string(value.get<int64_t>()).size();
+    case nlohmann::json::value_t::number_unsigned:
+        return std::to_string(value.get<uint64_t>()).size();
+    case nlohmann::json::value_t::boolean:
+        return value.get<bool>() ? 4 : 5;
+    default:
+        return 4; // null, or a short float
     }
+}
 
-    return response;
+// Stream buffer that appends whatever is written to it to a string
+class StringAppendBuffer : public std::streambuf {
+public:
+    explicit StringAppendBuffer(std::string& out) : out(out) {}
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            out.push_back(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize length) override {
+        out.append(data, length);
+        return length;
+    }
+
+private:
+    std::string& out;
+};
+
+// Same text as body_data.dump(), appended to out in place. Streaming the
+// json (with the stream's width left at 0) runs the same serializer as
+// dump(), through the library's public interface.
+static void dump_json_into(const nlohmann::json& body_data, std::string& out) {
+    StringAppendBuffer buffer(out);
+    std::ostream stream(&buffer);
+    stream << body_data;
 }
 
+// POST / PUT with the body serialized straight into the request
+static std::string compute_json_request(std::string_view method, const std::string& host, const std::string& url,
+                                        const std::string& content_type, const nlohmann::json& body_data,
+                                        const std::vector<std::string>& cookies, const std::string& jwt_token) {
+    RequestBuilder::BodyWriter writer = [&](std::string& out) { dump_json_into(body_data, out); };
+    return RequestBuilder(method, host, url)
+        .body(content_type, writer, json_size_hint(body_data))
+        .cookies(cookies)
+        .bearer_token(jwt_token)
+        .build();
+}
+
+// POST / PUT with the body in its own buffer
+static HttpRequest prepare_body_request(std::string_view method, const std::string& host, const std::string& url,
+                                        const std::string& content_type, std::string body_data,
+                                        const std::vector<std::string>& cookies, const std::string& jwt_token) {
+    HttpRequest request;
+    request.body = std::move(body_data);
+    RequestBuilder(method, host, url)
+        .body(content_type, request.body)
+        .cookies(cookies)
+        .bearer_token(jwt_token)
+        .build_head_into(request.head);
+    return request;
+}
+
+// Same, serializing the body into a buffer sized up front
+static HttpRequest prepare_json_request(std::string_view method, const std::string& host, const std::string& url,
+                                        const std::string& content_type, const nlohmann::json& body_data,
+                                        const std::vector<std::string>& cookies, const std::string& jwt_token) {
+    std::string body;
+    body.reserve(json_size_hint(body_data));
+    dump_json_into(body_data, body);
+    return prepare_body_request(method, host, url, content_type, std::move(body), cookies, jwt_token);
+}
 
 std::string compute_get_request (const std::string& host, const std::string& url,
                                 const std::string& query_params,
                                 const std::vector<std::string>& cookies,
                                 const std::string& jwt_token) {
-    std::ostringstream request_string;
-    request_string << "GET " << url;
-    if (!query_params.empty()) {
-        request_string << "?" << query_params;
-    }
-    request_string << " HTTP/1.1\r\n";
-    request_string << "Host: " << host << "\r\n";
-    if (!cookies.empty()) {
-        request_string << "Cookie: ";
-        for (size_t i = 0; i < cookies.size(); ++i) {
-            request_string << cookies[i] << (i == cookies.size() - 1 ? "" : "; ");
-        }
-        request_string << "\r\n";
-    }
-    if (!jwt_token.empty()) {
-        request_string << "Authorization: Bearer " << jwt_token << "\r\n";
-    }
-    request_string << "Connection: keep-alive\r\n";
-    request_string << "\r\n"; // End of headers
-    return request_string.str();
+    return RequestBuilder("GET", host, url)
+        .query(query_params)
+        .cookies(cookies)
+        .bearer_token(jwt_token)
+        .build();
 }
 
 std::string compute_post_request (const std::string& host, const std::string& url,
@@ -169,48 +454,24 @@ std::string compute_post_request (const std::string& host, const std::string& ur
                                 const nlohmann::json& body_data,
                                 const std::vector<std::string>& cookies,
                                 const std::string& jwt_token) {
-    std::ostringstream request_string;
-    std::string body_str = body_data.dump();
-
-    request_string << "POST " << url << " HTTP/1.1\r\n";
-    request_string << "Host: " << host << "\r\n";
-    request_string << "Content-Type: " << content_type << "\r\n";
-    request_string << "Content-Length: " << body_str.length() << "\r\n";
-    if (!cookies.empty()) {
-        request_string << "Cookie: ";
-        for (size_t i = 0; i < cookies.size(); ++i) {
-            request_string << cookies[i] << (i == cookies.size() - 1 ? "" : "; ");
-        }
-        request_string << "\r\n";
-    }
-    if (!jwt_token.empty()) {
-        request_string << "Authorization: Bearer " << jwt_token << "\r\n";
-    }
-    request_string << "Connection: keep-alive\r\n";
-    request_string << "\r\n"; // End of headers
-    request_string << body_str;
-    return request_string.str();
+    return compute_json_request("POST", host, url, content_type, body_data, cookies, jwt_token);
+}
+
+HttpRequest prepare_post_request (const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                const nlohmann::json& body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token) {
+    return prepare_json_request("POST", host, url, content_type, body_data, cookies, jwt_token);
 }
 
 std::string compute_delete_request (const std::string& host, const std::string& url,
                                     const std::vector<std::string>& cookies,
                                     const std::string& jwt_token) {
-    std::ostringstream request_string;
-    request_string << "DELETE " << url << " HTTP/1.1\r\n";
-    request_string << "Host: " << host << "\r\n";
-    if (!cookies.empty()) {
-        request_string << "Cookie: ";
-        for (size_t i = 0; i < cookies.size(); ++i) {
-            request_string << cookies[i] << (i == cookies.size() - 1 ? "" : "; ");
-        }
-        request_string << "\r\n";
-    }
-    if (!jwt_token.empty()) {
-        request_string << "Authorization: Bearer " << jwt_token << "\r\n";
-    }
-    request_string << "Connection: keep-alive\r\n";
-    request_string << "\r\n"; // End of headers
-    return request_string.str();
+    return RequestBuilder("DELETE", host, url)
+        .cookies(cookies)
+        .bearer_token(jwt_token)
+        .build();
 }
 
 std::string compute_put_request (const std::string& host, const std::string& url,
@@ -218,25 +479,68 @@ std::string compute_put_request (const std::string& host, const std::string& url
                                 const nlohmann::json& body_data,
                                 const std::vector<std::string>& cookies,
                                 const std::string& jwt_token) {
-    std::ostringstream request_string;
-    std::string body_str = body_data.dump();
-
-    request_string << "PUT " << url << " HTTP/1.1\r\n";
-    request_string << "Host: " << host << "\r\n";
-    request_string << "Content-Type: " << content_type << "\r\n";
-    request_string << "Content-Length: " << body_str.length() << "\r\n";
-    if (!cookies.empty()) {
-        request_string << "Cookie: ";
-        for (size_t i = 0; i < cookies.size(); ++i) {
-            request_string << cookies[i] << (i == cookies.size() - 1 ? "" : "; ");
-        }
-        request_string << "\r\n";
-    }
-    if (!jwt_token.empty()) {
-        request_string << "Authorization: Bearer " << jwt_token << "\r\n";
-    }
-    request_string << "Connection: keep-alive\r\n";
-    request_string << "\r\n"; // End of headers
-    request_string << body_str;
-    return request_string.str();
-}
\ No newline at end of file
+    return compute_json_request("PUT", host, url, content_type, body_data, cookies, jwt_token);
+}
+
+HttpRequest prepare_put_request (const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                const nlohmann::json& body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token) {
+    return prepare_json_request("PUT", host, url, content_type, body_data, cookies, jwt_token);
+}
+
+HttpRequest prepare_post_request (const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token) {
+    return prepare_body_request("POST", host, url, content_type, std::move(body_data), cookies, jwt_token);
+}
+
+HttpRequest prepare_put_request (const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token) {
+    return prepare_body_request("PUT", host, url, content_type, std::move(body_data), cookies, jwt_token);
+}
+
+std::string compute_get_request (const std::string& host, const std::string& url,
+                                const std::string& query_params, std::string_view header_block) {
+    return RequestBuilder("GET", host, url)
+        .query(query_params)
+        .header_block(header_block)
+        .build();
+}
+
+std::string compute_delete_request (const std::string& host, const std::string& url,
+                                    std::string_view header_block) {
+    return RequestBuilder("DELETE", host, url)
+        .header_block(header_block)
+        .build();
+}
+
+static HttpRequest prepare_body_request(std::string_view method, const std::string& host, const std::string& url,
+                                        const std::string& content_type, std::string body_data,
+                                        std::string_view header_block) {
+    HttpRequest request;
+    request.body = std::move(body_data);
+    RequestBuilder(method, host, url)
+        .body(content_type, request.body)
+        .header_block(header_block)
+        .build_head_into(request.head);
+    return request;
+}
+
+HttpRequest prepare_post_request (const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data, std::string_view header_block) {
+    return prepare_body_request("POST", host, url, content_type, std::move(body_data), header_block);
+}
+
+HttpRequest prepare_put_request (const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data, std::string_view header_block) {
+    return prepare_body_request("PUT", host, url, content_type, std::move(body_data), header_block);
+}
@@ -1,31 +1,213 @@
 #ifndef HTTP_REQUESTS_H
 #define HTTP_REQUESTS_H
 
+#include <cstdint>
+#include <chrono>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "nlohmann/json.hpp"
 
-// Structure to hold HTTP response
-struct HttpResponse {
+// Location of one header line inside the response buffer
+struct HeaderField {
+    size_t name_offset;
+    size_t name_length;
+    size_t value_offset;
+    size_t value_length;
+    int next_same_name = -1; // Next field with the same name, e.g. another Set-Cookie
+};
+
+// Case-insensitive lookup of header fields by name, filled while parsing.
+// An open-addressing table maps the name hash to the first field with that
+// name; names themselves are compared in place, inside the response buffer.
+struct HeaderIndex {
+    struct Slot {
+        uint32_t hash = 0;
+        int field = -1; // -1 marks an empty slot
+    };
+    std::vector<Slot> slots;
+    size_t used = 0;
+
+    // Registers fields[field]; chains it after earlier fields of the same name
+    void add(const std::string& buffer, std::vector<HeaderField>& fields, int field);
+
+    // First field with this name, -1 if none
+    int find(const std::string& buffer, const std::vector<HeaderField>& fields, std::string_view name) const;
+
+    void clear() { slots.clear(); used = 0; }
+};
+
+// Why a request got no response (HttpResponse::net_error). Network failures
+// are reported through these instead of exiting the client.
+enum NetError {
+    NET_OK = 0,
+    NET_RESOLVE_FAILED,    // Unknown host name
+    NET_CONNECT_FAILED,    // Refused, unreachable
+    NET_CONNECT_TIMEOUT,
+    NET_WRITE_TIMEOUT,
+    NET_READ_TIMEOUT,
+    NET_CONNECTION_CLOSED, // Closed or reset before a complete response
+    NET_BAD_RESPONSE,      // Not parseable as HTTP
+    NET_NO_CONNECTION,     // Connection limit reached
+    NET_IO_ERROR           // Any other socket error
+};
+
+const char* net_error_message(NetError error);
+
+// Limits for the blocking transports, in milliseconds; 0 waits forever.
+// The read timeout bounds the wait for each complete response, the write
+// timeout the time spent writing each request.
+struct NetTimeouts {
+    int connect_ms = 5000;
+    int read_ms = 30000;
+    int write_ms = 30000;
+};
+
+void set_net_timeouts(const NetTimeouts& timeouts);
+NetTimeouts get_net_timeouts();
+
+// Point in time timeout_ms from now (never if timeout_ms is 0), and the
+// milliseconds left until it, as poll() takes them (-1: no deadline)
+typedef std::chrono::steady_clock::time_point Deadline;
+Deadline deadline_after(int timeout_ms);
+int remaining_ms(Deadline deadline);
+
+// Separate copies of each part of a response, the way HttpResponse used to
+// store them. Only for code that really needs owning strings.
+struct OwnedHttpResponse {
     int status_code = 0;
     std::string headers;
     std::string body;
     std::string full_response;
+};
 
-    bool is_error() { 
+// HTTP response backed by the single buffer it was received into; the
+// accessors return views into that buffer instead of copies
+struct HttpResponse {
+    int status_code = 0;
+    bool keep_alive = true; // false if the server announced it will close the connection
+    NetError net_error = NET_OK; // Set when status_code is 0
+
+    std::string buffer;                   // Status line + headers + (decoded) body
+    size_t headers_length = 0;            // Up to, not including, the blank line
+    size_t body_offset = 0;
+    std::vector<HeaderField> header_fields;
+    HeaderIndex header_index;
+
+    std::string_view full_response() const { return buffer; }
+    std::string_view status_line() const {
+        return std::string_view(buffer).substr(0, buffer.find("\r\n"));
+    }
+    std::string_view headers() const { return std::string_view(buffer).substr(0, headers_length); }
+    std::string_view body() const { return std::string_view(buffer).substr(body_offset); }
+
+    // Value of the first header with this name (case-insensitive), empty if missing
+    std::string_view header(std::string_view name) const;
+
+    // Values of every header with this name, in the order they were received
+    std::vector<std::string_view> header_values(std::string_view name) const;
+
+    OwnedHttpResponse to_owned() const {
+        return {status_code, std::string(headers()), std::string(body()), buffer};
+    }
+
+    bool is_error() const {
         return status_code < 200 || status_code >= 300;
     }
 };
 
-// Opens a connection to the server
-int open_connection(const char* host_ip, int portno);
+// Takes the body of a successful (2xx) response piece by piece as it is
+// read, so it never has to be held in HttpResponse::buffer; the response
+// then has an empty body. Error responses are buffered as usual.
+typedef std::function<void(const char* data, size_t length)> BodySink;
+
+// Request kept as a header block and a body, sent together with one
+// writev so the body never has to be copied behind the headers
+struct HttpRequest {
+    std::string head; // Request line + headers + blank line
+    std::string body;
+};
+
+// Most pieces send_fragments passes to one sendmsg; longer lists take several
+#define MAX_FRAGMENTS 16
+
+// Default for how many requests send_pipelined keeps unanswered on the connection
+#define PIPELINE_WINDOW 32
+
+// I/O backend used to connect and to exchange single requests
+enum Transport { TRANSPORT_SYSCALLS, TRANSPORT_IO_URING };
+
+// Selects the backend. io_uring falls back to plain syscalls when the kernel
+// can't provide it; returns the backend actually in use.
+Transport set_transport(Transport transport);
+Transport get_transport();
+
+// "syscalls" or "io_uring"
+bool parse_transport(const std::string& name, Transport& transport);
+
+// Opens a connection to the server (host name or IPv4/IPv6 address), giving
+// up after the connect timeout. Names are resolved through the resolver
+// cache and multiple addresses are raced (resolver.h).
+// Returns -1 (and the reason in *error) on failure.
+int open_connection(const char* host, int portno, NetError* error = nullptr);
 
 // Closes the connection
 void close_connection(int sockfd);
 
-// Sends an HTTP request and receives the response
+// Sends an HTTP request and receives the response. On failure the response
+// has status_code 0 and net_error set.
 HttpResponse send_request_get_reply(int sockfd, const std::string& request_str);
 
+// Same as send_request_get_reply, but returns the error instead of filling it
+// into the response. After an error other than NET_CONNECTION_CLOSED the
+// connection is in an unknown state and must be closed. A successful body
+// goes to sink instead of the response when one is given.
+NetError try_send_request(int sockfd, const std::string& request_str, HttpResponse& response);
+NetError try_send_request(int sockfd, std::string_view head, std::string_view body, HttpResponse& response,
+                          const BodySink* sink = nullptr);
+
+// Writes the pieces back to back with writev (resuming after partial
+// writes), e.g. a header block, cached header lines and a body, within the
+// write timeout. More than MAX_FRAGMENTS pieces are sent in several calls.
+// NET_CONNECTION_CLOSED if the server closed the connection. *sent gets the
+// bytes written, also when it fails part way.
+NetError send_fragments(int sockfd, const std::string_view* fragments, size_t count,
+                        size_t* sent = nullptr);
+
+// Reads one complete response within the read timeout
+NetError receive_response(int sockfd, HttpResponse& response, const BodySink* sink = nullptr);
+
+// Waits until the socket is ready for events (POLLIN / POLLOUT) or
+// timeout_ms pass (< 0: forever). Returns false on timeout. A poll() error
+// returns true as well, so the read or write that follows reports it.
+bool wait_for_socket(int sockfd, short events, int timeout_ms);
+
+// Progress of a batch sent with send_pipelined
+struct PipelineProgress {
+    size_t written = 0;  // Requests written to the socket, at least in part
+    size_t answered = 0; // Responses received, in request order
+    NetError error = NET_OK; // Why it stopped early
+};
+
+// HTTP/1.1 pipelining: writes the requests back to back (keeping at most
+// window unanswered) and reads the replies, which arrive in order, appending
+// them to responses. Stops early if the connection breaks or the server
+// announces it is closing it.
+PipelineProgress send_pipelined(int sockfd, const std::vector<HttpRequest>& requests,
+                                std::vector<HttpResponse>& responses, size_t window = PIPELINE_WINDOW);
+PipelineProgress send_pipelined(int sockfd, const std::vector<std::string>& requests,
+                                std::vector<HttpResponse>& responses, size_t window = PIPELINE_WINDOW);
+
+// Pipelined counterpart of send_request_get_reply for a batch of prebuilt
+// requests. Returns one response per request, in order; the ones left
+// unanswered when the connection broke have status_code 0.
+std::vector<HttpResponse> send_requests_pipelined(int sockfd, const std::vector<std::string>& requests,
+                                                  size_t window = PIPELINE_WINDOW);
+
+// Checks (without blocking) that the server has not closed an idle connection
+bool is_connection_alive(int sockfd);
+
 
 // Request computation functions
 std::string compute_get_request(const std::string& host, const std::string& url,
@@ -49,4 +231,50 @@ std::string compute_put_request(const std::string& host, const std::string& url,
                                 const std::vector<std::string>& cookies,
                                 const std::string& jwt_token);
 
+// Same as compute_post_request / compute_put_request, but the serialized
+// body stays in its own buffer instead of being copied after the headers
+HttpRequest prepare_post_request(const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                const nlohmann::json& body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token);
+
+HttpRequest prepare_put_request(const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                const nlohmann::json& body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token);
+
+// Same with a body that is already serialized (e.g. by a JsonShape from
+// json_writer.h); it is moved into the request
+HttpRequest prepare_post_request(const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token);
+
+HttpRequest prepare_put_request(const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data,
+                                const std::vector<std::string>& cookies,
+                                const std::string& jwt_token);
+
+// Same requests with their Cookie, Authorization and Connection lines taken
+// from a block rendered once (Session::header_block), so the cookie and
+// token are not copied and joined for every request. The header order is
+// the same as with the overloads above.
+std::string compute_get_request(const std::string& host, const std::string& url,
+                                const std::string& query_params, std::string_view header_block);
+
+std::string compute_delete_request(const std::string& host, const std::string& url,
+                                std::string_view header_block);
+
+HttpRequest prepare_post_request(const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data, std::string_view header_block);
+
+HttpRequest prepare_put_request(const std::string& host, const std::string& url,
+                                const std::string& content_type,
+                                std::string body_data, std::string_view header_block);
+
 #endif // HTTP_REQUESTS_H
\ No newline at end of file
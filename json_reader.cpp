@@ -0,0 +1,348 @@
+#include "json_reader.h"
+#include <charconv>
+#include <climits>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE 64
+
+// Bit i of each mask is set when block[i] is a quote, a backslash, one of
+// { } [ ] : , one of { [ or one of } ] respectively
+#if defined(__SSE2__)
+static void classify_block(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& operators,
+                           uint64_t& opening, uint64_t& closing) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open_brace = _mm_set1_epi8('{');   // Also '[' once 0x20 is or-ed in
+    const __m128i close_brace = _mm_set1_epi8('}');  // Also ']'
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    quotes = backslashes = operators = opening = closing = 0;
+    for (int i = 0; i < BLOCK_SIZE / 16; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        __m128i folded = _mm_or_si128(chunk, case_bit);
+        __m128i opens = _mm_cmpeq_epi8(folded, open_brace);
+        __m128i closes = _mm_cmpeq_epi8(folded, close_brace);
+        __m128i ops = _mm_or_si128(_mm_or_si128(opens, closes),
+                                   _mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)));
+        quotes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) << (16 * i);
+        backslashes |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)) << (16 * i);
+        operators |= (uint64_t)(uint16_t)_mm_movemask_epi8(ops) << (16 * i);
+        opening |= (uint64_t)(uint16_t)_mm_movemask_epi8(opens) << (16 * i);
+        closing |= (uint64_t)(uint16_t)_mm_movemask_epi8(closes) << (16 * i);
+    }
+}
+#else
+static void classify_block(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& operators,
+                           uint64_t& opening, uint64_t& closing) {
+    quotes = backslashes = operators = opening = closing = 0;
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        char c = block[i];
+        uint64_t bit = (uint64_t)1 << i;
+        if (c == '"') quotes |= bit;
+        else if (c == '\\') backslashes |= bit;
+        else if (c == '{' || c == '[') operators |= bit, opening |= bit;
+        else if (c == '}' || c == ']') operators |= bit, closing |= bit;
+        else if (c == ':' || c == ',') operators |= bit;
+    }
+}
+#endif
+
+// Bit i set when an odd number of bits at or below i are set, i.e. which
+// bytes lie between an opening and a closing quote
+static uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+StructuralScanner::StructuralScanner(std::string_view document) : document(document) {}
+
+void StructuralScanner::index_block(const char* block) {
+    uint64_t quotes, backslashes, operators, opens, closes;
+    classify_block(block, quotes, backslashes, operators, opens, closes);
+
+    // Characters preceded by an odd run of backslashes are escaped. Runs
+    // starting on even and odd positions are added to the backslash bits,
+    // so the carry lands just past each run; the run was odd when it starts
+    // and ends on positions of different parity (simdjson's trick).
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    const uint64_t odd_bits = ~even_bits;
+    uint64_t run_starts = backslashes & ~(backslashes << 1);
+    uint64_t even_start_mask = even_bits ^ prev_odd_backslash;
+    uint64_t even_starts = run_starts & even_start_mask;
+    uint64_t odd_starts = run_starts & ~even_start_mask;
+    uint64_t even_carries = backslashes + even_starts;
+    uint64_t odd_carries;
+    bool ends_odd = __builtin_add_overflow(backslashes, odd_starts, &odd_carries);
+    odd_carries |= prev_odd_backslash; // A run continued from the previous block
+    prev_odd_backslash = ends_odd ? 1 : 0;
+    uint64_t even_carry_ends = even_carries & ~backslashes;
+    uint64_t odd_carry_ends = odd_carries & ~backslashes;
+    uint64_t escaped = (even_carry_ends & odd_bits) | (odd_carry_ends & even_bits);
+
+    quotes &= ~escaped;
+    uint64_t in_string = prefix_xor(quotes) ^ prev_in_string;
+    prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+    operators &= ~in_string;
+    mask = operators | quotes;
+    opening = opens & ~in_string;
+    closing = closes & ~in_string;
+}
+
+bool StructuralScanner::load_block() {
+    if (next_block >= document.size()) {
+        return false;
+    }
+    block_start = next_block;
+    next_block += BLOCK_SIZE;
+    if (document.size() - block_start >= BLOCK_SIZE) {
+        index_block(document.data() + block_start);
+    } else {
+        char padded[BLOCK_SIZE];
+        memset(padded, ' ', sizeof(padded));
+        memcpy(padded, document.data() + block_start, document.size() - block_start);
+        index_block(padded);
+    }
+    return true;
+}
+
+size_t StructuralScanner::next() {
+    while (mask == 0) {
+        if (!load_block()) {
+            return std::string_view::npos;
+        }
+    }
+    size_t pos = block_start + __builtin_ctzll(mask);
+    mask &= mask - 1;
+    return pos;
+}
+
+size_t StructuralScanner::skip_nested(int depth) {
+    while (true) {
+        while (mask == 0) {
+            if (!load_block()) {
+                return std::string_view::npos;
+            }
+        }
+        uint64_t opens = opening & mask;
+        uint64_t closes = closing & mask;
+        int close_count = __builtin_popcountll(closes);
+        if (close_count < depth) {
+            // Can't get back to depth 0 in this block
+            depth += __builtin_popcountll(opens) - close_count;
+            mask = 0;
+            continue;
+        }
+        for (uint64_t brackets = opens | closes; brackets; brackets &= brackets - 1) {
+            int bit = __builtin_ctzll(brackets);
+            if (opens & ((uint64_t)1 << bit)) {
+                depth++;
+            } else if (--depth == 0) {
+                mask &= ~(((uint64_t)2 << bit) - 1); // Up to and including it
+                return block_start + bit;
+            }
+        }
+        mask = 0;
+    }
+}
+
+void append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += (char)code_point;
+    } else if (code_point < 0x800) {
+        out += (char)(0xC0 | (code_point >> 6));
+        out += (char)(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += (char)(0xE0 | (code_point >> 12));
+        out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out += (char)(0x80 | (code_point & 0x3F));
+    } else {
+        out += (char)(0xF0 | (code_point >> 18));
+        out += (char)(0x80 | ((code_point >> 12) & 0x3F));
+        out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out += (char)(0x80 | (code_point & 0x3F));
+    }
+}
+
+static bool read_hex4(std::string_view raw, size_t pos, uint32_t& value) {
+    if (pos + 4 > raw.size()) return false;
+    auto result = std::from_chars(raw.data() + pos, raw.data() + pos + 4, value, 16);
+    return result.ec == std::errc() && result.ptr == raw.data() + pos + 4;
+}
+
+bool unescape_json_string(std::string_view raw, std::string& out) {
+    out.clear();
+    out.reserve(raw.size());
+    size_t pos = 0;
+    while (pos < raw.size()) {
+        size_t backslash = raw.find('\\', pos);
+        out.append(raw.data() + pos, (backslash == std::string_view::npos ? raw.size() : backslash) - pos);
+        if (backslash == std::string_view::npos) break;
+        if (backslash + 1 >= raw.size()) return false;
+
+        char c = raw[backslash + 1];
+        pos = backslash + 2;
+        switch (c) {
+        case '"': case '\\': case '/': out += c; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            uint32_t code_point;
+            if (!read_hex4(raw, pos, code_point)) return false;
+            pos += 4;
+            if (code_point >= 0xDC00 && code_point <= 0xDFFF) return false;
+            if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                uint32_t low;
+                if (raw.substr(pos, 2) != "\\u" || !read_hex4(raw, pos + 2, low)
+                    || low < 0xDC00 || low > 0xDFFF) {
+                    return false;
+                }
+                pos += 6;
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+            }
+            append_utf8(out, code_point);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+JsonObjectReader::JsonObjectReader(std::string_view document)
+    : document(document), scanner(document) {}
+
+size_t JsonObjectReader::skip_whitespace(size_t pos) const {
+    while (pos < document.size() && (document[pos] == ' ' || document[pos] == '\t'
+                                     || document[pos] == '\n' || document[pos] == '\r')) {
+        pos++;
+    }
+    return pos;
+}
+
+// Reads the next top-level "key": value; false at the end or on an error
+bool JsonObjectReader::next_field() {
+    const size_t npos = std::string_view::npos;
+    if (state == START) {
+        size_t open = scanner.next();
+        if (open == npos || document[open] != '{' || open != skip_whitespace(0)) {
+            state = FAILED;
+            return false;
+        }
+        state = FIELDS;
+    }
+    if (state != FIELDS) {
+        return false;
+    }
+
+    state = FAILED; // Until the field is complete
+    size_t key_open = scanner.next();
+    if (key_open == npos) return false;
+    if (document[key_open] == '}' && fields.empty()) {
+        state = END; // {}
+        return false;
+    }
+    size_t key_close = scanner.next();
+    size_t colon = scanner.next();
+    if (document[key_open] != '"' || key_close == npos || colon == npos || document[colon] != ':'
+        || skip_whitespace(key_close + 1) != colon) {
+        return false;
+    }
+
+    Field field;
+    field.key = document.substr(key_open + 1, key_close - key_open - 1);
+    field.value_start = skip_whitespace(colon + 1);
+    if (field.value_start >= document.size()) return false;
+
+    size_t separator;
+    char first = document[field.value_start];
+    if (first == '"' || first == '{' || first == '[') {
+        if (scanner.next() != field.value_start) return false;
+        size_t close;
+        if (first == '"') {
+            close = scanner.next();
+        } else {
+            close = scanner.skip_nested(1); // Everything inside is skipped
+        }
+        if (close == npos) return false;
+        field.value_end = close + 1;
+        separator = scanner.next();
+        if (separator == npos || skip_whitespace(field.value_end) != separator) return false;
+    } else {
+        // Number, true, false or null: runs up to the separator
+        separator = scanner.next();
+        if (separator == npos) return false;
+        field.value_end = separator;
+        while (field.value_end > field.value_start && (document[field.value_end - 1] == ' '
+               || document[field.value_end - 1] == '\t' || document[field.value_end - 1] == '\n'
+               || document[field.value_end - 1] == '\r')) {
+            field.value_end--;
+        }
+        if (field.value_end == field.value_start) return false;
+    }
+
+    if (document[separator] == ',') state = FIELDS;
+    else if (document[separator] == '}') state = END;
+    else return false;
+    fields.push_back(field);
+    return true;
+}
+
+static bool key_equals(std::string_view raw, std::string_view key) {
+    if (raw.find('\\') == std::string_view::npos) {
+        return raw == key;
+    }
+    std::string decoded;
+    return unescape_json_string(raw, decoded) && decoded == key;
+}
+
+const JsonObjectReader::Field* JsonObjectReader::find(std::string_view key) {
+    for (const Field& field : fields) {
+        if (key_equals(field.key, key)) return &field;
+    }
+    while (next_field()) {
+        if (key_equals(fields.back().key, key)) return &fields.back();
+    }
+    return nullptr;
+}
+
+bool JsonObjectReader::has(std::string_view key) {
+    return find(key) != nullptr;
+}
+
+bool JsonObjectReader::get_string(std::string_view key, std::string& value) {
+    const Field* field = find(key);
+    if (!field || document[field->value_start] != '"') {
+        return false;
+    }
+    return unescape_json_string(document.substr(field->value_start + 1, field->value_end - field->value_start - 2),
+                                value);
+}
+
+bool JsonObjectReader::get_int(std::string_view key, int& value) {
+    const Field* field = find(key);
+    if (!field) {
+        return false;
+    }
+    const char* begin = document.data() + field->value_start;
+    const char* end = document.data() + field->value_end;
+    long long parsed;
+    auto result = std::from_chars(begin, end, parsed);
+    if (result.ec != std::errc() || result.ptr != end || parsed < INT_MIN || parsed > INT_MAX) {
+        return false;
+    }
+    value = (int)parsed;
+    return true;
+}
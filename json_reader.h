@@ -0,0 +1,84 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Finds the JSON structural characters ({ } [ ] : , and the quotes around
+// strings) of a document 64 bytes at a time, the way simdjson's first stage
+// does: bit masks of quotes and backslashes give the escaped characters and
+// the inside of strings, and what is left of the brackets, colons and commas
+// outside strings is structural. Blocks are indexed only as positions are
+// asked for, so a lookup near the start never touches the rest.
+class StructuralScanner {
+public:
+    explicit StructuralScanner(std::string_view document);
+
+    // Position of the next structural character, npos at the end
+    size_t next();
+
+    // Skips to the bracket closing a value opened depth levels up (1: the
+    // one just returned by next()), looking only at brackets; blocks that
+    // can't contain it are stepped over whole. npos if it never closes.
+    size_t skip_nested(int depth);
+
+private:
+    std::string_view document;
+    size_t block_start = 0;          // Offset of the block in mask
+    size_t next_block = 0;
+    uint64_t mask = 0;               // Structurals of that block not returned yet
+    uint64_t opening = 0;            // The { and [ among them
+    uint64_t closing = 0;            // The } and ]
+    uint64_t prev_in_string = 0;     // All ones if the previous block ended inside a string
+    uint64_t prev_odd_backslash = 0; // 1 if it ended with an odd run of backslashes
+
+    bool load_block();
+    void index_block(const char* block);
+};
+
+// Reads fields of a top-level JSON object on demand, e.g. "id" out of a
+// reply, without building a document. Only the top level is walked; nested
+// values are skipped over by their brackets and fields passed on the way
+// are remembered for the next lookup, and a lookup stops at the first field
+// with its key. Values are checked as they are read, not the document as a
+// whole. The document must outlive the reader.
+class JsonObjectReader {
+public:
+    explicit JsonObjectReader(std::string_view document);
+
+    // False if the field is missing or not of that type
+    bool get_string(std::string_view key, std::string& value);
+    bool get_int(std::string_view key, int& value);
+    bool has(std::string_view key);
+
+    // The document is not a well-formed object (as far as it was read)
+    bool failed() const { return state == FAILED; }
+
+private:
+    enum State { START, FIELDS, END, FAILED };
+
+    struct Field {
+        std::string_view key; // Raw, as written between the quotes
+        size_t value_start;
+        size_t value_end;
+    };
+
+    std::string_view document;
+    StructuralScanner scanner;
+    State state = START;
+    std::vector<Field> fields;
+
+    const Field* find(std::string_view key);
+    bool next_field();
+    size_t skip_whitespace(size_t pos) const;
+};
+
+// Appends a code point as UTF-8
+void append_utf8(std::string& out, uint32_t code_point);
+
+// Decodes the inside of a JSON string (escapes included); false if malformed
+bool unescape_json_string(std::string_view raw, std::string& out);
+
+#endif // JSON_READER_H
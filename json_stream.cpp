@@ -0,0 +1,204 @@
+#include "json_stream.h"
+#include "json_reader.h"
+#include <algorithm>
+#include <cctype>
+
+// The character a two-character escape like \n stands for
+static bool unescape(char c, char& out) {
+    switch (c) {
+    case '"': case '\\': case '/': out = c; return true;
+    case 'b': out = '\b'; return true;
+    case 'f': out = '\f'; return true;
+    case 'n': out = '\n'; return true;
+    case 'r': out = '\r'; return true;
+    case 't': out = '\t'; return true;
+    default: return false;
+    }
+}
+
+JsonListScanner::JsonListScanner(std::string list_key, std::string field_key, ItemCallback on_item)
+    : list_key(std::move(list_key)), field_key(std::move(field_key)), on_item(std::move(on_item)) {}
+
+void JsonListScanner::feed(const char* data, size_t length) {
+    size_t pos = 0;
+    while (pos < length && state != FAILED) {
+        char c = data[pos];
+        switch (state) {
+        case TOKENS:
+            pos++;
+            if (c == '"') {
+                string_start();
+                state = STRING;
+            } else {
+                structural(c);
+            }
+            break;
+        case STRING: {
+            // Plain characters are taken as one run
+            size_t end = pos;
+            while (end < length && data[end] != '"' && data[end] != '\\') end++;
+            if (end > pos) {
+                if (high_surrogate) {
+                    state = FAILED; // Unpaired \uD800-\uDBFF
+                    break;
+                }
+                string_chars(data + pos, end - pos);
+                pos = end;
+                break;
+            }
+            pos++;
+            if (c == '\\') {
+                state = STRING_ESCAPE;
+            } else if (high_surrogate) {
+                state = FAILED;
+            } else {
+                string_end();
+                state = TOKENS;
+            }
+            break;
+        }
+        case STRING_ESCAPE: {
+            pos++;
+            char unescaped;
+            if (c == 'u') {
+                state = STRING_UNICODE;
+                unicode_digits = 0;
+                code_unit = 0;
+            } else if (!unescape(c, unescaped) || high_surrogate) {
+                state = FAILED;
+            } else {
+                string_chars(&unescaped, 1);
+                state = STRING;
+            }
+            break;
+        }
+        case STRING_UNICODE:
+            pos++;
+            if (!isxdigit((unsigned char)c)) {
+                state = FAILED;
+                break;
+            }
+            code_unit = code_unit * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+            if (++unicode_digits < 4) {
+                break;
+            }
+            state = STRING;
+            if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
+                if (high_surrogate) state = FAILED;
+                high_surrogate = code_unit;
+            } else if (code_unit >= 0xDC00 && code_unit <= 0xDFFF) {
+                if (!high_surrogate) {
+                    state = FAILED;
+                    break;
+                }
+                append_code_point(0x10000 + ((high_surrogate - 0xD800) << 10) + (code_unit - 0xDC00));
+                high_surrogate = 0;
+            } else if (high_surrogate) {
+                state = FAILED;
+            } else {
+                append_code_point(code_unit);
+            }
+            break;
+        case FAILED:
+            break;
+        }
+    }
+}
+
+bool JsonListScanner::in_item() const {
+    return in_list && containers.size() == 3;
+}
+
+void JsonListScanner::structural(char c) {
+    if (document_done && !isspace((unsigned char)c)) {
+        state = FAILED; // Something after the end of the document
+        return;
+    }
+    switch (c) {
+    case '{':
+        if (in_list && containers.size() == 2) {
+            value.clear();
+            value_found = false;
+        }
+        containers.push_back('{');
+        expect_key = true;
+        key_matches = false;
+        break;
+    case '[':
+        if (containers.size() == 1 && key_matches && !in_list) {
+            in_list = true;
+        }
+        containers.push_back('[');
+        expect_key = false;
+        break;
+    case '}':
+    case ']':
+        if (containers.empty() || containers.back() != (c == '}' ? '{' : '[')) {
+            state = FAILED;
+            return;
+        }
+        if (c == '}' && in_item()) {
+            item_count++;
+            on_item(value, value_found);
+        }
+        containers.pop_back();
+        if (c == ']' && in_list && containers.size() == 1) {
+            in_list = false; // Only the first list under list_key is read
+            list_key.clear();
+            list_done = true;
+        }
+        document_done = containers.empty();
+        expect_key = false;
+        break;
+    case ':':
+        expect_key = false;
+        break;
+    case ',':
+        expect_key = !containers.empty() && containers.back() == '{';
+        key_matches = false;
+        break;
+    default:
+        break; // Whitespace, numbers, true, false, null
+    }
+}
+
+void JsonListScanner::string_start() {
+    reading_key = expect_key && !containers.empty() && containers.back() == '{';
+    capture_key = reading_key && (containers.size() == 1 || in_item());
+    capture_value = !reading_key && key_matches && in_item();
+    key_too_long = false;
+    key.clear();
+    if (capture_value) {
+        value.clear();
+    }
+}
+
+void JsonListScanner::string_end() {
+    if (reading_key) {
+        const std::string& wanted = containers.size() == 1 ? list_key : field_key;
+        key_matches = capture_key && !key_too_long && !wanted.empty() && key == wanted;
+    } else if (capture_value) {
+        value_found = true;
+    }
+    reading_key = capture_key = capture_value = false;
+}
+
+void JsonListScanner::string_chars(const char* data, size_t length) {
+    if (capture_key) {
+        // Keys longer than the ones looked for can't match
+        size_t limit = std::max(list_key.size(), field_key.size());
+        if (key.size() + length > limit) {
+            key_too_long = true;
+        } else {
+            key.append(data, length);
+        }
+    } else if (capture_value) {
+        value.append(data, length);
+    }
+}
+
+void JsonListScanner::append_code_point(uint32_t code_point) {
+    std::string utf8;
+    append_utf8(utf8, code_point);
+    string_chars(utf8.data(), utf8.size());
+}
@@ -0,0 +1,73 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+// Pulls one string field out of every object of a list in a JSON document
+// fed in pieces, e.g. the titles in {"movies": [{"id": 1, "title": "..."}]},
+// without building the document. Memory depends on the nesting depth and
+// the longest value, not on the length of the list.
+class JsonListScanner {
+public:
+    // Called once per object of the list, with the decoded field value;
+    // found is false if the object has no such string field
+    typedef std::function<void(std::string_view value, bool found)> ItemCallback;
+
+    // list_key is a key of the top-level object, field_key a key of the
+    // objects in that list
+    JsonListScanner(std::string list_key, std::string field_key, ItemCallback on_item);
+
+    // Scans the next piece of the document; a piece may end anywhere,
+    // including inside a string or an escape sequence
+    void feed(const char* data, size_t length);
+
+    // Malformed JSON was seen; everything after it is ignored
+    bool failed() const { return state == FAILED; }
+
+    // The list was read to its closing ']' and the document has ended, so
+    // no item was lost to a truncated body
+    bool complete() const { return state != FAILED && list_done && document_done; }
+
+    size_t items() const { return item_count; }
+
+private:
+    enum State { TOKENS, STRING, STRING_ESCAPE, STRING_UNICODE, FAILED };
+
+    std::string list_key;
+    std::string field_key;
+    ItemCallback on_item;
+
+    State state = TOKENS;
+    std::vector<char> containers;  // '{' and '[' currently open
+    bool expect_key = false;       // The next string in this object is a key
+    bool in_list = false;          // Inside the list under list_key
+    bool key_matches = false;      // The last key was the one we look for
+
+    // The string being read, only kept when it is a key or value we need
+    bool reading_key = false;
+    bool capture_key = false;
+    bool capture_value = false;
+    bool key_too_long = false;
+    std::string key;
+    std::string value;
+    bool value_found = false;
+    unsigned unicode_digits = 0;
+    uint32_t code_unit = 0;
+    uint32_t high_surrogate = 0;
+    size_t item_count = 0;
+    bool list_done = false;
+    bool document_done = false;
+
+    void structural(char c);
+    void string_start();
+    void string_end();
+    void string_chars(const char* data, size_t length);
+    void append_code_point(uint32_t code_point);
+    bool in_item() const; // Directly inside an object of the list
+};
+
+#endif // JSON_STREAM_H
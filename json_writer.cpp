@@ -0,0 +1,133 @@
+#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+
+// Longest number text: a shortest-form double ("-2.2250738585072014e-308")
+// or a 64-bit integer
+#define MAX_NUMBER_CHARS 32
+
+// Length of the UTF-8 sequence at s (1 to 4); valid is false if it is
+// malformed, the length then covering the bytes that still looked right
+// (replaced by one U+FFFD, as Unicode recommends)
+static size_t utf8_sequence_length(const unsigned char* s, size_t available, bool& valid) {
+    unsigned char lead = s[0];
+    size_t length;
+    unsigned char min_second = 0x80, max_second = 0xBF; // Rules out overlongs and surrogates
+    valid = false;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) min_second = 0xA0;
+        if (lead == 0xED) max_second = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) min_second = 0x90;
+        if (lead == 0xF4) max_second = 0x8F;
+    } else {
+        return 1;
+    }
+    if (available < 2 || s[1] < min_second || s[1] > max_second) {
+        return 1;
+    }
+    for (size_t i = 2; i < length; i++) {
+        if (i >= available || (s[i] & 0xC0) != 0x80) return i;
+    }
+    valid = true;
+    return length;
+}
+
+void append_json_string(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char* s = (const unsigned char*)value.data();
+    size_t length = value.size();
+    out += '"';
+    size_t run = 0; // Start of the bytes that can be copied as they are
+    size_t i = 0;
+    while (i < length) {
+        unsigned char c = s[i];
+        if (c >= 0x20 && c != '"' && c != '\\' && c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t skip = 1;
+        if (c >= 0x80) {
+            bool valid;
+            skip = utf8_sequence_length(s + i, length - i, valid);
+            if (valid) {
+                i += skip;
+                continue;
+            }
+        }
+        out.append(value.data() + run, i - run);
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\b': out.append("\\b"); break;
+        case '\f': out.append("\\f"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c < 0x20) {
+                out.append("\\u00").append(1, hex[c >> 4]).append(1, hex[c & 0xF]);
+            } else {
+                out.append("\xEF\xBF\xBD"); // U+FFFD for a malformed sequence
+            }
+        }
+        i += skip;
+        run = i;
+    }
+    out.append(value.data() + run, length - run);
+    out += '"';
+}
+
+void append_json_integer(std::string& out, long long value) {
+    char digits[MAX_NUMBER_CHARS];
+    auto result = std::to_chars(digits, digits + MAX_NUMBER_CHARS, value);
+    out.append(digits, result.ptr - digits);
+}
+
+void append_json_unsigned(std::string& out, unsigned long long value) {
+    char digits[MAX_NUMBER_CHARS];
+    auto result = std::to_chars(digits, digits + MAX_NUMBER_CHARS, value);
+    out.append(digits, result.ptr - digits);
+}
+
+// Laid out like nlohmann::json: plain decimals while the point falls within
+// the first 15 digits (or up to 3 zeros after it), exponent notation
+// otherwise
+void append_json_double(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out.append("null");
+        return;
+    }
+    char text[MAX_NUMBER_CHARS];
+    auto result = std::to_chars(text, text + MAX_NUMBER_CHARS, value, std::chars_format::scientific);
+    std::string_view scientific(text, result.ptr - text);
+    size_t e = scientific.find('e');
+    if (scientific[0] == '-') {
+        out += '-';
+        scientific.remove_prefix(1);
+        e--;
+    }
+    // Shortest digits, and where the point goes among them
+    char digits[MAX_NUMBER_CHARS];
+    int count = 0;
+    for (size_t i = 0; i < e; i++) {
+        if (scientific[i] != '.') digits[count++] = scientific[i];
+    }
+    int exponent = 0;
+    std::from_chars(scientific.data() + e + (scientific[e + 1] == '+' ? 2 : 1), scientific.data() + scientific.size(), exponent);
+    int point = exponent + 1;
+
+    if (count <= point && point <= 15) {
+        out.append(digits, count).append(point - count, '0').append(".0");
+    } else if (0 < point && point <= 15) {
+        out.append(digits, point).append(".").append(digits + point, count - point);
+    } else if (-4 < point && point <= 0) {
+        out.append("0.").append(-point, '0').append(digits, count);
+    } else {
+        out.append(scientific);
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Appends value as a JSON string, quotes included. Invalid UTF-8 is
+// replaced with U+FFFD instead of being sent as is.
+void append_json_string(std::string& out, std::string_view value);
+
+void append_json_integer(std::string& out, long long value);
+void append_json_unsigned(std::string& out, unsigned long long value);
+
+// Shortest form that reads back the same, with ".0" added to whole numbers
+// as nlohmann::json does; NaN and infinities become null
+void append_json_double(std::string& out, double value);
+
+template <typename T>
+void append_json_value(std::string& out, const T& value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out.append(value ? "true" : "false");
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        append_json_integer(out, value);
+    } else if constexpr (std::is_integral_v<T>) {
+        append_json_unsigned(out, value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        append_json_double(out, value);
+    } else {
+        append_json_string(out, std::string_view(value));
+    }
+}
+
+// Room a value is likely to take, for reserving the output
+template <typename T>
+size_t json_value_size_hint(const T& value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return 24;
+    } else {
+        return std::string_view(value).size() * 9 / 8 + 2;
+    }
+}
+
+// A JSON object with fixed keys, e.g. {"username": ..., "password": ...}.
+// The text around the values ({"username":  ,"password":  }) is laid out
+// at compile time by json_shape(), so encoding a payload only appends
+// those pieces and the escaped values: no nlohmann::json tree is built
+// and walked per request. Keys must not need escaping.
+template <size_t Size, size_t Count>
+struct JsonShape {
+    char text[Size] = {};
+    size_t piece_end[Count + 1] = {}; // Piece i ends where value i goes
+
+    // Appends the object with one value per key, in key order
+    template <typename... Values>
+    void write(std::string& out, const Values&... values) const {
+        static_assert(sizeof...(Values) == Count, "one value per key");
+        size_t piece = 0;
+        size_t start = 0;
+        auto field = [&](const auto& value) {
+            out.append(text + start, piece_end[piece] - start);
+            start = piece_end[piece++];
+            append_json_value(out, value);
+        };
+        (field(values), ...);
+        out.append(text + start, piece_end[Count] - start);
+    }
+
+    template <typename... Values>
+    std::string encode(const Values&... values) const {
+        std::string out;
+        out.reserve(piece_end[Count] + (json_value_size_hint(values) + ... + 0));
+        write(out, values...);
+        return out;
+    }
+};
+
+// Each key adds {" or ," before it and ": after it; the object closes with }
+template <size_t... Lengths>
+constexpr JsonShape<((Lengths + 3) + ... + 0) + 1, sizeof...(Lengths)> json_shape(const char (&... keys)[Lengths]) {
+    static_assert(sizeof...(Lengths) > 0, "at least one key");
+    JsonShape<((Lengths + 3) + ... + 0) + 1, sizeof...(Lengths)> shape;
+    const char* names[] = {keys...};
+    size_t lengths[] = {(Lengths - 1)...};
+    size_t pos = 0;
+    for (size_t i = 0; i < sizeof...(Lengths); i++) {
+        shape.text[pos++] = i == 0 ? '{' : ',';
+        shape.text[pos++] = '"';
+        for (size_t j = 0; j < lengths[i]; j++) {
+            shape.text[pos++] = names[i][j];
+        }
+        shape.text[pos++] = '"';
+        shape.text[pos++] = ':';
+        shape.piece_end[i] = pos;
+    }
+    shape.text[pos++] = '}';
+    shape.piece_end[sizeof...(Lengths)] = pos;
+    return shape;
+}
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,180 @@
+#include "load_balancer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+bool parse_balance_policy(const std::string& name, BalancePolicy& policy) {
+    if (name == "round_robin") policy = BALANCE_ROUND_ROBIN;
+    else if (name == "least_outstanding") policy = BALANCE_LEAST_OUTSTANDING;
+    else if (name == "p2c") policy = BALANCE_POWER_OF_TWO;
+    else return false;
+    return true;
+}
+
+bool parse_endpoints(const std::string& list, int default_port, std::vector<Endpoint>& endpoints) {
+    std::vector<Endpoint> parsed;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        std::string entry = list.substr(start, comma - start);
+        start = comma + 1;
+
+        entry.erase(0, entry.find_first_not_of(" \t"));
+        entry.erase(entry.find_last_not_of(" \t") + 1);
+        if (entry.empty()) return false;
+
+        Endpoint endpoint = {entry, default_port};
+        size_t port_colon = std::string::npos;
+        if (entry[0] == '[') {
+            size_t bracket = entry.find(']');
+            if (bracket == std::string::npos) return false;
+            endpoint.host = entry.substr(1, bracket - 1);
+            if (bracket + 1 < entry.size()) {
+                if (entry[bracket + 1] != ':') return false;
+                port_colon = bracket + 1;
+            }
+        } else if (entry.find(':') != entry.rfind(':')) {
+            return false; // Bare IPv6 literal; the port would be ambiguous
+        } else {
+            port_colon = entry.find(':');
+            endpoint.host = entry.substr(0, port_colon);
+        }
+        if (port_colon != std::string::npos) {
+            std::string port = entry.substr(port_colon + 1);
+            char* end = nullptr;
+            long parsed_port = strtol(port.c_str(), &end, 10);
+            if (port.empty() || *end != '\0' || parsed_port < 1 || parsed_port > 65535) return false;
+            endpoint.port = (int)parsed_port;
+        }
+        if (endpoint.host.empty()) return false;
+        parsed.push_back(endpoint);
+    }
+    endpoints = parsed;
+    return true;
+}
+
+bool is_connection_failure(NetError error) {
+    return error == NET_RESOLVE_FAILED || error == NET_CONNECT_FAILED
+        || error == NET_CONNECT_TIMEOUT || error == NET_IO_ERROR;
+}
+
+LoadBalancer::LoadBalancer(std::vector<Endpoint> endpoints, BalancePolicy policy)
+    : endpoints(std::move(endpoints)), policy(policy), health(this->endpoints.size()) {}
+
+size_t LoadBalancer::pick(const std::vector<size_t>& skip) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto now = std::chrono::steady_clock::now();
+
+    std::vector<size_t> candidates;
+    candidates.reserve(endpoints.size());
+    for (size_t i = 0; i < endpoints.size(); i++) {
+        if (health[i].ejected_until <= now && std::find(skip.begin(), skip.end(), i) == skip.end()) {
+            candidates.push_back(i);
+        }
+    }
+
+    size_t chosen;
+    if (candidates.empty()) {
+        // Better to try the likeliest to have recovered than to fail outright
+        chosen = endpoints.size();
+        for (size_t i = 0; i < endpoints.size(); i++) {
+            bool skipped = std::find(skip.begin(), skip.end(), i) != skip.end();
+            if (skipped && skip.size() < endpoints.size()) continue;
+            if (chosen == endpoints.size() || health[i].ejected_until < health[chosen].ejected_until) chosen = i;
+        }
+    } else {
+        chosen = choose(candidates);
+    }
+    health[chosen].outstanding++;
+    return chosen;
+}
+
+size_t LoadBalancer::choose(const std::vector<size_t>& candidates) {
+    if (candidates.size() == 1) {
+        return candidates[0];
+    }
+
+    if (policy == BALANCE_ROUND_ROBIN) {
+        // The first candidate at or after the rotating position
+        size_t position = next++ % endpoints.size();
+        auto found = std::lower_bound(candidates.begin(), candidates.end(), position);
+        return found != candidates.end() ? *found : candidates[0];
+    }
+
+    if (policy == BALANCE_LEAST_OUTSTANDING) {
+        // Scanned from a rotating start so that ties are spread out
+        size_t start = next++ % candidates.size();
+        size_t best = candidates[start];
+        for (size_t k = 1; k < candidates.size(); k++) {
+            size_t i = candidates[(start + k) % candidates.size()];
+            if (health[i].outstanding < health[best].outstanding) best = i;
+        }
+        return best;
+    }
+
+    // Power of two choices: comparing two random endpoints avoids the herd
+    // that always taking the global best causes, at a cost close to it.
+    // Latency is weighted by the load so a fast but busy endpoint is not
+    // piled on; unmeasured endpoints cost 0 and get tried first. One that
+    // failed to connect recently (not yet enough to eject it) loses to one
+    // that didn't, until it is due to be probed again.
+    static thread_local std::minstd_rand random(std::random_device{}());
+    size_t a = random() % candidates.size();
+    size_t b = random() % (candidates.size() - 1);
+    if (b >= a) b++;
+    const Health& first = health[candidates[a]];
+    const Health& second = health[candidates[b]];
+    auto probe_after = std::chrono::steady_clock::now() - std::chrono::milliseconds(BALANCER_EJECT_MS);
+    bool first_failing = first.failures_in_row > 0 && first.last_failure > probe_after;
+    bool second_failing = second.failures_in_row > 0 && second.last_failure > probe_after;
+    if (first_failing != second_failing) {
+        return first_failing ? candidates[b] : candidates[a];
+    }
+    double first_cost = first.latency_ms * (first.outstanding + 1);
+    double second_cost = second.latency_ms * (second.outstanding + 1);
+    return first_cost <= second_cost ? candidates[a] : candidates[b];
+}
+
+void LoadBalancer::finish(size_t index, std::chrono::steady_clock::duration elapsed, NetError error) {
+    std::lock_guard<std::mutex> guard(lock);
+    Health& entry = health[index];
+    if (entry.outstanding > 0) {
+        entry.outstanding--;
+    }
+    if (error == NET_NO_CONNECTION) {
+        return; // Our own connection limit, says nothing about the endpoint
+    }
+    entry.requests++;
+
+    if (is_connection_failure(error)) {
+        entry.failures++;
+        entry.failures_in_row++;
+        entry.last_failure = std::chrono::steady_clock::now();
+        // Once ejected, one more failure right after coming back is enough
+        if (entry.failures_in_row >= BALANCER_EJECT_AFTER) {
+            long long eject_ms = (long long)BALANCER_EJECT_MS << std::min(entry.ejections, 16);
+            eject_ms = std::min(eject_ms, (long long)BALANCER_MAX_EJECT_MS);
+            entry.ejected_until = entry.last_failure + std::chrono::milliseconds(eject_ms);
+            entry.ejections++;
+        }
+        return;
+    }
+
+    entry.failures_in_row = 0;
+    entry.ejections = 0;
+    double sample_ms = std::chrono::duration<double, std::milli>(elapsed).count();
+    entry.latency_ms = entry.latency_ms == 0 ? sample_ms
+                     : BALANCER_EWMA_ALPHA * sample_ms + (1 - BALANCER_EWMA_ALPHA) * entry.latency_ms;
+}
+
+std::vector<LoadBalancer::EndpointStats> LoadBalancer::stats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    auto now = std::chrono::steady_clock::now();
+    std::vector<EndpointStats> result;
+    for (const Health& entry : health) {
+        result.push_back({entry.outstanding, entry.latency_ms, entry.requests, entry.failures,
+                          entry.ejected_until > now});
+    }
+    return result;
+}
@@ -0,0 +1,94 @@
+#ifndef LOAD_BALANCER_H
+#define LOAD_BALANCER_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include "http_requests.h"
+
+// Weight of the newest sample in an endpoint's average latency
+#define BALANCER_EWMA_ALPHA 0.3
+// Connection failures in a row before an endpoint is ejected
+#define BALANCER_EJECT_AFTER 3
+// First ejection; doubled each time it fails again right after coming back
+#define BALANCER_EJECT_MS 5000
+#define BALANCER_MAX_EJECT_MS 120000
+
+// One replica of the API
+struct Endpoint {
+    std::string host;
+    int port;
+};
+
+enum BalancePolicy {
+    BALANCE_ROUND_ROBIN,       // Each endpoint in turn
+    BALANCE_LEAST_OUTSTANDING, // The one with the fewest requests in flight
+    BALANCE_POWER_OF_TWO,      // The cheaper of two random ones, by latency x load
+};
+
+// "round_robin", "least_outstanding" or "p2c"; false for anything else
+bool parse_balance_policy(const std::string& name, BalancePolicy& policy);
+
+// Parses "host:port,host:port,..." ("[::1]:8081" for IPv6 literals, the
+// port may be left out to use default_port). False on a malformed entry.
+bool parse_endpoints(const std::string& list, int default_port, std::vector<Endpoint>& endpoints);
+
+// Spreads requests over several endpoints and keeps track of their health.
+// Thread-safe; one balancer can be shared by several ConnectionManagers so
+// that the in-flight counts cover all of them.
+class LoadBalancer {
+public:
+    LoadBalancer(std::vector<Endpoint> endpoints, BalancePolicy policy = BALANCE_ROUND_ROBIN);
+
+    LoadBalancer(const LoadBalancer&) = delete;
+    LoadBalancer& operator=(const LoadBalancer&) = delete;
+
+    // Index of the endpoint for the next request, counted as in flight until
+    // finish(). Ejected endpoints are skipped; if all of them are ejected
+    // the one coming back soonest is used. Endpoints in skip (already tried
+    // for this request) are only used when there is nothing else.
+    size_t pick(const std::vector<size_t>& skip = {});
+
+    // Reports how the request sent with pick()'s index went. Connection
+    // failures count towards ejection; any other outcome (including HTTP
+    // errors and read timeouts) feeds the latency average.
+    void finish(size_t index, std::chrono::steady_clock::duration elapsed, NetError error);
+
+    const Endpoint& endpoint(size_t index) const { return endpoints[index]; }
+    size_t size() const { return endpoints.size(); }
+
+    struct EndpointStats {
+        size_t outstanding;
+        double latency_ms;       // Average, 0 until the first reply
+        unsigned long requests;
+        unsigned long failures;  // Connection failures
+        bool ejected;
+    };
+    std::vector<EndpointStats> stats() const;
+
+private:
+    struct Health {
+        size_t outstanding = 0;
+        double latency_ms = 0;
+        unsigned long requests = 0;
+        unsigned long failures = 0;
+        int failures_in_row = 0;
+        int ejections = 0; // Since the last success
+        std::chrono::steady_clock::time_point last_failure;
+        std::chrono::steady_clock::time_point ejected_until;
+    };
+
+    std::vector<Endpoint> endpoints;
+    BalancePolicy policy;
+    mutable std::mutex lock;
+    std::vector<Health> health;
+    size_t next = 0; // Round-robin position
+
+    size_t choose(const std::vector<size_t>& candidates);
+};
+
+// Resolve, connect and I/O errors, which point at the endpoint itself
+bool is_connection_failure(NetError error);
+
+#endif // LOAD_BALANCER_H
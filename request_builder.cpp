@@ -0,0 +1,165 @@
+#include "request_builder.h"
+#include <charconv>
+
+// Longest decimal size_t
+#define MAX_LENGTH_DIGITS 20
+
+RequestBuilder::RequestBuilder(std::string_view method, std::string_view host, std::string_view url)
+    : method(method), host(host), url(url) {}
+
+RequestBuilder& RequestBuilder::query(std::string_view query_params) {
+    this->query_params = query_params;
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::cookies(const std::vector<std::string>& cookies) {
+    cookie_list = &cookies;
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::bearer_token(std::string_view jwt_token) {
+    this->jwt_token = jwt_token;
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::header_block(std::string_view block) {
+    cached_headers = block;
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::body(std::string_view content_type, std::string_view body_data) {
+    this->content_type = content_type;
+    this->body_data = body_data;
+    has_body = true;
+    return *this;
+}
+
+RequestBuilder& RequestBuilder::body(std::string_view content_type, const BodyWriter& writer, size_t length_hint) {
+    this->content_type = content_type;
+    body_writer = &writer;
+    this->length_hint = length_hint;
+    has_body = true;
+    return *this;
+}
+
+static size_t decimal_length(size_t value) {
+    size_t digits = 1;
+    while (value >= 10) {
+        value /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+size_t RequestBuilder::body_length() const {
+    return body_writer ? length_hint : body_data.size();
+}
+
+size_t RequestBuilder::size() const {
+    return head_size() + body_length();
+}
+
+size_t RequestBuilder::head_size() const {
+    size_t total = method.size() + 1 + url.size() + sizeof(" HTTP/1.1\r\n") - 1;
+    if (!query_params.empty()) {
+        total += 1 + query_params.size();
+    }
+    total += sizeof("Host: \r\n") - 1 + host.size();
+    if (has_body) {
+        total += sizeof("Content-Type: \r\n") - 1 + content_type.size();
+        total += sizeof("Content-Length: \r\n") - 1 + decimal_length(body_length());
+    }
+    total += cached_headers.empty() ? session_headers_size() : cached_headers.size();
+    total += sizeof("\r\n") - 1;
+    return total;
+}
+
+size_t RequestBuilder::session_headers_size() const {
+    size_t total = 0;
+    if (cookie_list && !cookie_list->empty()) {
+        total += sizeof("Cookie: \r\n") - 1;
+        for (const std::string& cookie : *cookie_list) {
+            total += cookie.size();
+        }
+        total += 2 * (cookie_list->size() - 1); // "; " separators
+    }
+    if (!jwt_token.empty()) {
+        total += sizeof("Authorization: Bearer \r\n") - 1 + jwt_token.size();
+    }
+    total += sizeof("Connection: keep-alive\r\n") - 1;
+    return total;
+}
+
+void RequestBuilder::build_into(std::string& out) const {
+    out.reserve(out.size() + size());
+    size_t length_pos = write_head(out);
+    if (!body_writer) {
+        out.append(body_data);
+        return;
+    }
+    size_t body_start = out.size();
+    (*body_writer)(out);
+    char digits[MAX_LENGTH_DIGITS];
+    auto result = std::to_chars(digits, digits + MAX_LENGTH_DIGITS, out.size() - body_start);
+    out.replace(length_pos, decimal_length(length_hint), digits, result.ptr - digits);
+}
+
+void RequestBuilder::build_head_into(std::string& out) const {
+    out.reserve(out.size() + head_size());
+    write_head(out);
+}
+
+// Returns where the Content-Length digits start (npos without a body)
+size_t RequestBuilder::write_head(std::string& out) const {
+    size_t length_pos = std::string::npos;
+
+    out.append(method).append(" ").append(url);
+    if (!query_params.empty()) {
+        out.append("?").append(query_params);
+    }
+    out.append(" HTTP/1.1\r\n");
+    out.append("Host: ").append(host).append("\r\n");
+    if (has_body) {
+        char digits[MAX_LENGTH_DIGITS];
+        auto result = std::to_chars(digits, digits + MAX_LENGTH_DIGITS, body_length());
+        out.append("Content-Type: ").append(content_type).append("\r\n");
+        out.append("Content-Length: ");
+        length_pos = out.size();
+        out.append(digits, result.ptr - digits).append("\r\n");
+    }
+    if (cached_headers.empty()) {
+        write_session_headers(out);
+    } else {
+        out.append(cached_headers);
+    }
+    out.append("\r\n"); // End of headers
+    return length_pos;
+}
+
+void RequestBuilder::write_session_headers(std::string& out) const {
+    if (cookie_list && !cookie_list->empty()) {
+        out.append("Cookie: ");
+        for (size_t i = 0; i < cookie_list->size(); ++i) {
+            if (i > 0) out.append("; ");
+            out.append((*cookie_list)[i]);
+        }
+        out.append("\r\n");
+    }
+    if (!jwt_token.empty()) {
+        out.append("Authorization: Bearer ").append(jwt_token).append("\r\n");
+    }
+    out.append("Connection: keep-alive\r\n");
+}
+
+std::string RequestBuilder::build_header_block() const {
+    std::string block;
+    block.reserve(session_headers_size());
+    write_session_headers(block);
+    return block;
+}
+
+std::string RequestBuilder::build() const {
+    std::string request;
+    build_into(request);
+    return request;
+}
@@ -0,0 +1,74 @@
+#ifndef REQUEST_BUILDER_H
+#define REQUEST_BUILDER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+// Builds an HTTP/1.1 request in a single buffer. The exact length is
+// computed from the parts first, so the output is allocated once and
+// written front to back with no intermediate copies.
+// The builder only keeps views: the parts must outlive build().
+class RequestBuilder {
+public:
+    // Appends a body to the request being built, e.g. a JSON serializer
+    typedef std::function<void(std::string& out)> BodyWriter;
+
+    RequestBuilder(std::string_view method, std::string_view host, std::string_view url);
+
+    RequestBuilder& query(std::string_view query_params);
+    RequestBuilder& cookies(const std::vector<std::string>& cookies);
+    RequestBuilder& bearer_token(std::string_view jwt_token);
+
+    // Cookie, Authorization and Connection lines rendered earlier by
+    // build_header_block(), used as they are instead of the cookies and
+    // token given here
+    RequestBuilder& header_block(std::string_view block);
+    RequestBuilder& body(std::string_view content_type, std::string_view body_data);
+
+    // Body written straight after the headers by build_into(), so it never
+    // exists in a buffer of its own; Content-Length is patched in once it is
+    // written. length_hint is the expected size: the buffer is reserved for
+    // it and the digits get its width (a wrong guess costs one move of the
+    // body). build_head_into() can't be used with it.
+    RequestBuilder& body(std::string_view content_type, const BodyWriter& writer, size_t length_hint);
+
+    // Exact length of the serialized request, and of its header block alone
+    // (estimated from length_hint with a body writer)
+    size_t size() const;
+    size_t head_size() const;
+
+    // Appends the request to out, e.g. a buffer reused across requests
+    void build_into(std::string& out) const;
+
+    // Appends only the request line and headers, for sending the body separately
+    void build_head_into(std::string& out) const;
+
+    std::string build() const;
+
+    // The Cookie, Authorization and Connection lines alone, for
+    // header_block() of later requests with the same credentials
+    std::string build_header_block() const;
+
+private:
+    std::string_view method;
+    std::string_view host;
+    std::string_view url;
+    std::string_view query_params;
+    std::string_view jwt_token;
+    std::string_view cached_headers;
+    std::string_view content_type;
+    std::string_view body_data;
+    const BodyWriter* body_writer = nullptr;
+    size_t length_hint = 0;
+    const std::vector<std::string>* cookie_list = nullptr;
+    bool has_body = false;
+
+    size_t body_length() const;
+    size_t write_head(std::string& out) const;
+    size_t session_headers_size() const;
+    void write_session_headers(std::string& out) const;
+};
+
+#endif // REQUEST_BUILDER_H
@@ -0,0 +1,172 @@
+#include "resolver.h"
+#include "socket_options.h"
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+struct CacheEntry {
+    std::vector<ResolvedAddress> addresses;
+    std::chrono::steady_clock::time_point expires;
+};
+
+static std::mutex cache_lock;
+static std::map<std::string, CacheEntry> resolver_cache;
+
+// IPv6, IPv4, IPv6, ... keeping getaddrinfo's order within each family
+static std::vector<ResolvedAddress> interleave_families(const std::vector<ResolvedAddress>& found) {
+    std::vector<ResolvedAddress> v6, v4, ordered;
+    for (const ResolvedAddress& address : found) {
+        (address.family == AF_INET6 ? v6 : v4).push_back(address);
+    }
+    for (size_t i = 0; i < v6.size() || i < v4.size(); i++) {
+        if (i < v6.size()) ordered.push_back(v6[i]);
+        if (i < v4.size()) ordered.push_back(v4[i]);
+    }
+    return ordered;
+}
+
+bool resolve_host(const std::string& host, int port, std::vector<ResolvedAddress>& addresses, NetError* error) {
+    std::string key = host + ":" + std::to_string(port);
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> guard(cache_lock);
+        auto cached = resolver_cache.find(key);
+        if (cached != resolver_cache.end() && cached->second.expires > now) {
+            addresses = cached->second.addresses;
+            return true;
+        }
+    }
+
+    // Resolved without holding the lock; two threads may both ask, which
+    // is harmless
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG | AI_NUMERICSERV;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        if (error) *error = NET_RESOLVE_FAILED;
+        return false;
+    }
+
+    std::vector<ResolvedAddress> found;
+    for (struct addrinfo* info = result; info; info = info->ai_next) {
+        if ((info->ai_family != AF_INET && info->ai_family != AF_INET6)
+            || info->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        ResolvedAddress address;
+        memset(&address, 0, sizeof(address));
+        memcpy(&address.addr, info->ai_addr, info->ai_addrlen);
+        address.addr_len = info->ai_addrlen;
+        address.family = info->ai_family;
+        found.push_back(address);
+    }
+    freeaddrinfo(result);
+    if (found.empty()) {
+        if (error) *error = NET_RESOLVE_FAILED;
+        return false;
+    }
+
+    addresses = interleave_families(found);
+    std::lock_guard<std::mutex> guard(cache_lock);
+    resolver_cache[key] = {addresses, now + std::chrono::milliseconds(RESOLVER_CACHE_TTL_MS)};
+    return true;
+}
+
+void clear_resolver_cache() {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    resolver_cache.clear();
+}
+
+int happy_eyeballs_connect(const std::vector<ResolvedAddress>& addresses, int timeout_ms, NetError* error) {
+    NetError ignored;
+    if (!error) error = &ignored;
+    *error = NET_CONNECT_FAILED;
+
+    // With Fast Open, connect() "succeeds" before any packet is sent, which
+    // would make the first address win every race
+    SocketProfile profile = get_socket_profile();
+    if (addresses.size() > 1) {
+        profile.tcp_fastopen = false;
+    }
+
+    Deadline deadline = deadline_after(timeout_ms);
+    auto next_start = std::chrono::steady_clock::now();
+    std::vector<struct pollfd> attempts;
+    size_t next = 0;
+    int winner = -1;
+
+    while (winner < 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (next < addresses.size() && (attempts.empty() || now >= next_start)) {
+            const ResolvedAddress& address = addresses[next++];
+            next_start = now + std::chrono::milliseconds(HAPPY_EYEBALLS_DELAY_MS);
+            int sockfd = socket(address.family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            if (sockfd < 0) {
+                continue;
+            }
+            apply_socket_profile(sockfd, profile);
+            if (connect(sockfd, (const struct sockaddr*)&address.addr, address.addr_len) == 0) {
+                winner = sockfd;
+            } else if (errno == EINPROGRESS) {
+                attempts.push_back({sockfd, POLLOUT, 0});
+            } else {
+                close(sockfd); // Refused or unreachable: the next one starts now
+                next_start = now;
+            }
+            continue;
+        }
+        if (attempts.empty()) {
+            break; // Every address failed
+        }
+
+        int wait_ms = remaining_ms(deadline);
+        if (wait_ms == 0) {
+            *error = NET_CONNECT_TIMEOUT;
+            break;
+        }
+        if (next < addresses.size()) {
+            auto until_next = std::chrono::duration_cast<std::chrono::milliseconds>(next_start - now).count();
+            if (wait_ms < 0 || until_next < wait_ms) wait_ms = until_next > 0 ? (int)until_next : 0;
+        }
+        int ready = poll(attempts.data(), attempts.size(), wait_ms);
+        if (ready < 0 && errno != EINTR) {
+            *error = NET_IO_ERROR;
+            break;
+        }
+
+        for (size_t i = 0; i < attempts.size() && ready > 0;) {
+            if (!attempts[i].revents) {
+                i++;
+                continue;
+            }
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                winner = attempts[i].fd;
+                attempts.erase(attempts.begin() + i);
+                break;
+            }
+            close(attempts[i].fd);
+            attempts.erase(attempts.begin() + i);
+            next_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    for (const struct pollfd& attempt : attempts) {
+        close(attempt.fd);
+    }
+    if (winner < 0) {
+        return -1;
+    }
+    fcntl(winner, F_SETFL, fcntl(winner, F_GETFL, 0) & ~O_NONBLOCK);
+    *error = NET_OK;
+    return winner;
+}
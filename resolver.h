@@ -0,0 +1,40 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include "http_requests.h"
+
+// How long resolved addresses are reused before asking the resolver again
+#define RESOLVER_CACHE_TTL_MS 60000
+
+// Delay before racing the next address when a connect hasn't finished
+// (the "Connection Attempt Delay" of RFC 8305)
+#define HAPPY_EYEBALLS_DELAY_MS 250
+
+struct ResolvedAddress {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int family; // AF_INET or AF_INET6
+};
+
+// Resolves host (name, IPv4 or IPv6 literal) and port with getaddrinfo.
+// Results are cached per host:port for RESOLVER_CACHE_TTL_MS, so repeated
+// connects don't wait for the resolver. Addresses come back interleaved by
+// family, IPv6 first, the order happy_eyeballs_connect tries them in.
+// Returns false (with NET_RESOLVE_FAILED in *error) if nothing was found.
+bool resolve_host(const std::string& host, int port, std::vector<ResolvedAddress>& addresses,
+                  NetError* error = nullptr);
+
+// Drops every cached entry, e.g. after a deployment moved
+void clear_resolver_cache();
+
+// Connects to the first address that answers. Each attempt starts
+// HAPPY_EYEBALLS_DELAY_MS after the previous one (or as soon as it fails)
+// while earlier ones keep going; the losers are closed. Returns a blocking
+// socket with the socket profile applied, or -1 with the reason in *error.
+int happy_eyeballs_connect(const std::vector<ResolvedAddress>& addresses, int timeout_ms,
+                           NetError* error = nullptr);
+
+#endif // RESOLVER_H
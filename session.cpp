@@ -0,0 +1,145 @@
+#include <mutex>
+#include "session.h"
+#include "request_builder.h"
+
+typedef std::shared_lock<std::shared_mutex> ReadGuard;
+typedef std::unique_lock<std::shared_mutex> WriteGuard;
+
+std::string Session::admin_cookie() const {
+    ReadGuard guard(lock);
+    return admin_cookie_value;
+}
+
+std::string Session::admin_username() const {
+    ReadGuard guard(lock);
+    return admin_username_value;
+}
+
+std::string Session::user_cookie() const {
+    ReadGuard guard(lock);
+    return user_cookie_value;
+}
+
+std::string Session::jwt_token() const {
+    ReadGuard guard(lock);
+    return jwt_token_value;
+}
+
+bool Session::admin_logged_in() const {
+    ReadGuard guard(lock);
+    return !admin_cookie_value.empty();
+}
+
+bool Session::user_logged_in() const {
+    ReadGuard guard(lock);
+    return !user_cookie_value.empty();
+}
+
+bool Session::has_library_access() const {
+    ReadGuard guard(lock);
+    return !jwt_token_value.empty();
+}
+
+void Session::set_admin(const std::string& cookie, const std::string& username) {
+    WriteGuard guard(lock);
+    admin_cookie_value = cookie;
+    admin_username_value = username;
+    header_blocks[AUTH_ADMIN_COOKIE].reset();
+}
+
+void Session::clear_admin_cookie() {
+    WriteGuard guard(lock);
+    admin_cookie_value.clear(); // The username stays, later user logins check it
+    header_blocks[AUTH_ADMIN_COOKIE].reset();
+}
+
+void Session::set_user_cookie(const std::string& cookie) {
+    WriteGuard guard(lock);
+    user_cookie_value = cookie;
+    header_blocks[AUTH_USER_COOKIE].reset();
+}
+
+void Session::clear_user_cookie() {
+    WriteGuard guard(lock);
+    user_cookie_value.clear();
+    header_blocks[AUTH_USER_COOKIE].reset();
+}
+
+void Session::set_jwt_token(const std::string& token) {
+    WriteGuard guard(lock);
+    jwt_token_value = token;
+    header_blocks[AUTH_JWT].reset();
+}
+
+void Session::clear_jwt_token() {
+    WriteGuard guard(lock);
+    jwt_token_value.clear();
+    header_blocks[AUTH_JWT].reset();
+}
+
+std::shared_ptr<const std::string> Session::header_block(RequestAuth auth) const {
+    {
+        ReadGuard guard(lock);
+        if (header_blocks[auth]) {
+            return header_blocks[auth];
+        }
+    }
+    WriteGuard guard(lock);
+    if (!header_blocks[auth]) {
+        std::vector<std::string> cookies;
+        if (auth == AUTH_ADMIN_COOKIE) cookies.push_back(admin_cookie_value);
+        if (auth == AUTH_USER_COOKIE) cookies.push_back(user_cookie_value);
+        header_blocks[auth] = std::make_shared<const std::string>(RequestBuilder("", "", "")
+            .cookies(cookies)
+            .bearer_token(auth == AUTH_JWT ? jwt_token_value : "")
+            .build_header_block());
+    }
+    return header_blocks[auth];
+}
+
+// The ID at a 1-based index of ids, if there is one
+static bool find_id(const std::vector<int>& ids, size_t index, int& id) {
+    if (index < 1 || index > ids.size()) {
+        return false;
+    }
+    id = ids[index - 1];
+    return true;
+}
+
+bool Session::find_movie_id(size_t index, int& id) const {
+    ReadGuard guard(lock);
+    return find_id(movie_ids, index, id);
+}
+
+bool Session::take_movie_id(size_t index, int& id) {
+    WriteGuard guard(lock);
+    if (!find_id(movie_ids, index, id)) {
+        return false;
+    }
+    movie_ids.erase(movie_ids.begin() + index - 1);
+    return true;
+}
+
+void Session::add_movie_id(int id) {
+    WriteGuard guard(lock);
+    movie_ids.push_back(id);
+}
+
+bool Session::find_collection_id(size_t index, int& id) const {
+    ReadGuard guard(lock);
+    return find_id(collection_ids, index, id);
+}
+
+bool Session::take_collection_id(size_t index, int& id) {
+    WriteGuard guard(lock);
+    if (!find_id(collection_ids, index, id)) {
+        return false;
+    }
+    collection_ids.erase(collection_ids.begin() + index - 1);
+    return true;
+}
+
+void Session::add_collection_id(int id) {
+    WriteGuard guard(lock);
+    collection_ids.push_back(id);
+}
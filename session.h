@@ -0,0 +1,66 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <shared_mutex>
+
+// Credentials a request carries: none, one of the session cookies, or the
+// library JWT as a bearer token
+enum RequestAuth { AUTH_NONE, AUTH_ADMIN_COOKIE, AUTH_USER_COOKIE, AUTH_JWT };
+#define AUTH_KINDS 4
+
+// Client state shared by the command handlers: session cookies, the
+// library JWT and the real server IDs behind the 1-based indexes the user
+// types. Every accessor takes the lock (shared for reads), so read-only
+// commands can run from several threads while another one updates it.
+class Session {
+public:
+    std::string admin_cookie() const;
+    std::string admin_username() const;
+    std::string user_cookie() const;
+    std::string jwt_token() const;
+
+    bool admin_logged_in() const;
+    bool user_logged_in() const;
+    bool has_library_access() const;
+
+    // Admin login sets both together
+    void set_admin(const std::string& cookie, const std::string& username);
+    void clear_admin_cookie();
+    void set_user_cookie(const std::string& cookie);
+    void clear_user_cookie();
+    void set_jwt_token(const std::string& token);
+    void clear_jwt_token();
+
+    // Cookie / Authorization and Connection lines for requests with these
+    // credentials (RequestBuilder::header_block). Rendered on first use and
+    // kept until the cookie or token changes; a block handed out stays
+    // valid after that.
+    std::shared_ptr<const std::string> header_block(RequestAuth auth) const;
+
+    // Server IDs by 1-based index. The range check and the lookup (or
+    // removal) happen under one lock, so another thread changing the list
+    // can't slip in between; false if index isn't in [1, count].
+    bool find_movie_id(size_t index, int& id) const;
+    bool take_movie_id(size_t index, int& id);
+    void add_movie_id(int id);
+
+    bool find_collection_id(size_t index, int& id) const;
+    bool take_collection_id(size_t index, int& id);
+    void add_collection_id(int id);
+
+private:
+    mutable std::shared_mutex lock;
+    std::string admin_cookie_value;
+    std::string admin_username_value;
+    std::string user_cookie_value;
+    std::string jwt_token_value;
+    std::vector<int> movie_ids, collection_ids;
+
+    // Rendered header blocks by RequestAuth
+    mutable std::shared_ptr<const std::string> header_blocks[AUTH_KINDS];
+};
+
+#endif // SESSION_H
@@ -0,0 +1,103 @@
+#include "socket_options.h"
+#include "helpers.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30 // Linux 4.11+, missing from older headers
+#endif
+
+static std::mutex profile_lock;
+static SocketProfile active_profile;
+static std::atomic<bool> quickack_enabled(SocketProfile().tcp_quickack);
+
+static bool parse_bool(const std::string& value, bool& out) {
+    if (value == "1" || value == "true" || value == "on" || value == "yes") out = true;
+    else if (value == "0" || value == "false" || value == "off" || value == "no") out = false;
+    else return false;
+    return true;
+}
+
+static bool parse_size(const std::string& value, int& out) {
+    char* end = nullptr;
+    long parsed = strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || parsed < 0 || parsed > (1L << 30)) return false;
+    out = (int)parsed;
+    return true;
+}
+
+bool set_socket_option(SocketProfile& profile, const std::string& key, const std::string& value) {
+    if (key == "tcp_nodelay") return parse_bool(value, profile.tcp_nodelay);
+    if (key == "tcp_quickack") return parse_bool(value, profile.tcp_quickack);
+    if (key == "send_buffer") return parse_size(value, profile.send_buffer);
+    if (key == "receive_buffer") return parse_size(value, profile.receive_buffer);
+    if (key == "tcp_fastopen") return parse_bool(value, profile.tcp_fastopen);
+    return false;
+}
+
+bool load_socket_profile(const std::string& path, SocketProfile& profile, std::string& error_msg) {
+    return read_config_file(path, [&profile](const std::string& key, const std::string& value) {
+        return set_socket_option(profile, key, value);
+    }, error_msg);
+}
+
+void apply_socket_env(SocketProfile& profile, std::vector<std::string>& ignored) {
+    const char* names[][2] = {
+        {"HTTP_CLIENT_TCP_NODELAY", "tcp_nodelay"},
+        {"HTTP_CLIENT_TCP_QUICKACK", "tcp_quickack"},
+        {"HTTP_CLIENT_SNDBUF", "send_buffer"},
+        {"HTTP_CLIENT_RCVBUF", "receive_buffer"},
+        {"HTTP_CLIENT_TCP_FASTOPEN", "tcp_fastopen"},
+    };
+    for (auto& name : names) {
+        const char* value = getenv(name[0]);
+        if (value && !set_socket_option(profile, name[1], value)) {
+            ignored.push_back(std::string(name[0]) + ": Bad value for " + name[1] + ": " + value + " (ignored)");
+        }
+    }
+}
+
+void set_socket_profile(const SocketProfile& profile) {
+    std::lock_guard<std::mutex> guard(profile_lock);
+    active_profile = profile;
+    quickack_enabled = profile.tcp_quickack;
+}
+
+SocketProfile get_socket_profile() {
+    std::lock_guard<std::mutex> guard(profile_lock);
+    return active_profile;
+}
+
+void apply_socket_profile(int sockfd, const SocketProfile& profile) {
+    int on = 1;
+    if (profile.tcp_nodelay) {
+        setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    if (profile.tcp_quickack) {
+        setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+    }
+    // Buffer sizes have to be set before connecting to affect the window scale
+    if (profile.send_buffer > 0) {
+        setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &profile.send_buffer, sizeof(profile.send_buffer));
+    }
+    if (profile.receive_buffer > 0) {
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &profile.receive_buffer, sizeof(profile.receive_buffer));
+    }
+    // connect() then returns at once and the SYN goes out with the first
+    // write. Without kernel support (or without a cookie for the server yet)
+    // it is an ordinary handshake, so a failure here needs no handling.
+    if (profile.tcp_fastopen) {
+        setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on));
+    }
+}
+
+void rearm_quickack(int sockfd) {
+    if (quickack_enabled.load(std::memory_order_relaxed)) {
+        int on = 1;
+        setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SOCKET_OPTIONS_H
+#define SOCKET_OPTIONS_H
+
+#include <string>
+#include <vector>
+
+// TCP options applied to every connection to the server. Requests are small
+// writes answered right away, the pattern Nagle's algorithm and delayed
+// ACKs slow down most.
+struct SocketProfile {
+    bool tcp_nodelay = true;    // Send each request immediately (no Nagle)
+    bool tcp_quickack = false;  // ACK replies at once; re-armed before every read
+    int send_buffer = 0;        // SO_SNDBUF in bytes, 0 keeps the kernel default
+    int receive_buffer = 0;     // SO_RCVBUF in bytes, 0 keeps the kernel default
+    bool tcp_fastopen = false;  // Carry the first request in the SYN when possible
+};
+
+// Reads "key = value" lines (# starts a comment) over the fields of profile.
+// Keys: tcp_nodelay, tcp_quickack, send_buffer, receive_buffer, tcp_fastopen.
+// Returns false with a message in error_msg on an unreadable file or a bad line.
+bool load_socket_profile(const std::string& path, SocketProfile& profile, std::string& error_msg);
+
+// Sets one field by its config key; false for an unknown key or a bad value
+bool set_socket_option(SocketProfile& profile, const std::string& key, const std::string& value);
+
+// Overrides fields from HTTP_CLIENT_TCP_NODELAY, HTTP_CLIENT_TCP_QUICKACK,
+// HTTP_CLIENT_SNDBUF, HTTP_CLIENT_RCVBUF and HTTP_CLIENT_TCP_FASTOPEN. A bad
+// value keeps the setting; a message naming the variable and the value is
+// added to ignored.
+void apply_socket_env(SocketProfile& profile, std::vector<std::string>& ignored);
+
+// The profile used by open_connection and AsyncClient
+void set_socket_profile(const SocketProfile& profile);
+SocketProfile get_socket_profile();
+
+// Sets the options on a socket that is not connected yet. Options the
+// kernel doesn't support are skipped (TCP Fast Open falls back to a
+// normal handshake).
+void apply_socket_profile(int sockfd, const SocketProfile& profile);
+
+// TCP_QUICKACK is cleared by the kernel after use; call before each read
+// when the profile asks for it
+void rearm_quickack(int sockfd);
+
+#endif // SOCKET_OPTIONS_H
@@ -0,0 +1,359 @@
+#include "uring_transport.h"
+#include "http_parser.h"
+#include "socket_options.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+
+#define SEND_TAG 1
+#define READ_TAG 2
+#define CONNECT_TAG 3
+#define TIMEOUT_TAG 4
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+IoUring::~IoUring() {
+    if (sqes) munmap(sqes, sqes_size);
+    if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+    if (sq_ring) munmap(sq_ring, sq_ring_size);
+    if (ring_fd >= 0) close(ring_fd);
+    free(buffer);
+}
+
+bool IoUring::init(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        return false; // ENOSYS on old kernels, EPERM when disabled or filtered
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && cq_ring_size > sq_ring_size) {
+        sq_ring_size = cq_ring_size;
+    }
+
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        sq_ring = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring = sq_ring;
+    } else {
+        cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            cq_ring = nullptr;
+            return false;
+        }
+    }
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_SQES);
+    if (sqes_map == MAP_FAILED) {
+        return false;
+    }
+    sqes = (struct io_uring_sqe*)sqes_map;
+
+    char* sq = (char*)sq_ring;
+    char* cq = (char*)cq_ring;
+    sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq + params.sq_off.array);
+    cq_head = (unsigned*)(cq + params.cq_off.head);
+    cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    if (!probe_ops()) {
+        return false;
+    }
+
+    buffer = (char*)malloc(URING_BUFFER_SIZE);
+    if (!buffer) {
+        return false;
+    }
+    struct iovec fixed = {buffer, URING_BUFFER_SIZE};
+    return io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, &fixed, 1) == 0;
+}
+
+// SENDMSG, READ_FIXED, CONNECT and LINK_TIMEOUT came in different kernel versions
+bool IoUring::probe_ops() {
+    size_t probe_size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    std::unique_ptr<char[]> storage(new char[probe_size]());
+    struct io_uring_probe* probe = (struct io_uring_probe*)storage.get();
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0) {
+        return false;
+    }
+    const unsigned needed[] = {IORING_OP_SENDMSG, IORING_OP_READ_FIXED, IORING_OP_CONNECT,
+                               IORING_OP_LINK_TIMEOUT};
+    for (unsigned op : needed) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct io_uring_sqe* IoUring::next_sqe() {
+    unsigned tail = *sq_tail + queued;
+    unsigned index = tail & *sq_mask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    queued++;
+    return sqe;
+}
+
+void IoUring::queue_read(int sockfd, uint64_t user_data, bool linked) {
+    struct io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->flags = linked ? IOSQE_IO_LINK : 0;
+    sqe->fd = sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = URING_BUFFER_SIZE;
+    sqe->off = (uint64_t)-1; // Sockets have no file position
+    sqe->buf_index = 0;
+    sqe->user_data = user_data;
+}
+
+// Cancels the previous (linked) SQE if it hasn't completed after timeout_ms.
+// ts only has to live until the SQE is submitted.
+void IoUring::queue_link_timeout(struct __kernel_timespec* ts, int timeout_ms) {
+    ts->tv_sec = timeout_ms / 1000;
+    ts->tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+    struct io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)ts;
+    sqe->len = 1;
+    sqe->user_data = TIMEOUT_TAG;
+}
+
+// Publishes the queued SQEs and waits for wait_count completions
+bool IoUring::submit_and_wait(unsigned wait_count) {
+    __atomic_store_n(sq_tail, *sq_tail + queued, __ATOMIC_RELEASE);
+    unsigned to_submit = queued;
+    queued = 0;
+    while (true) {
+        int ret = io_uring_enter(ring_fd, to_submit, wait_count, IORING_ENTER_GETEVENTS);
+        if (ret >= 0) return true;
+        if (errno != EINTR) return false;
+        to_submit = 0; // Already consumed by the kernel
+    }
+}
+
+bool IoUring::reap(uint64_t user_data_out[], int results_out[], unsigned count) {
+    unsigned head = *cq_head;
+    for (unsigned i = 0; i < count; i++) {
+        while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN) {
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+                return false; // The ring itself is broken (EBADF, EFAULT, ENXIO...)
+            }
+        }
+        struct io_uring_cqe* cqe = &cqes[head & *cq_mask];
+        user_data_out[i] = cqe->user_data;
+        results_out[i] = cqe->res;
+        head++;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+int IoUring::connect(int sockfd, const struct sockaddr* addr, socklen_t addr_len, int timeout_ms) {
+    struct io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->off = addr_len;
+    sqe->user_data = CONNECT_TAG;
+    struct __kernel_timespec ts;
+    unsigned expected = 1;
+    if (timeout_ms > 0) {
+        sqe->flags = IOSQE_IO_LINK;
+        queue_link_timeout(&ts, timeout_ms);
+        expected = 2;
+    }
+    if (!submit_and_wait(expected)) {
+        return -1;
+    }
+
+    uint64_t tags[2];
+    int results[2];
+    if (!reap(tags, results, expected)) {
+        return -1;
+    }
+    int result = 0;
+    bool timed_out = false;
+    for (unsigned i = 0; i < expected; i++) {
+        if (tags[i] == CONNECT_TAG) result = results[i];
+        else timed_out = results[i] == -ETIME;
+    }
+    if (result < 0) {
+        errno = timed_out ? ETIMEDOUT : -result;
+        return -1;
+    }
+    return 0;
+}
+
+NetError IoUring::send_request(int sockfd, std::string_view head, std::string_view body, HttpResponse& response,
+                               const BodySink* sink) {
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)head.data();
+    iov[0].iov_len = head.size();
+    iov[1].iov_base = (void*)body.data();
+    iov[1].iov_len = body.size();
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = body.empty() ? 1 : 2;
+
+    // The read timeout covers the whole response; each read gets a linked
+    // timeout for what is left of it
+    int timeout_ms = get_net_timeouts().read_ms;
+    Deadline deadline = deadline_after(timeout_ms);
+    struct __kernel_timespec ts;
+
+    // Send linked to the first read: one syscall for both
+    struct io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)&message;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = SEND_TAG;
+    queue_read(sockfd, READ_TAG, timeout_ms > 0);
+    unsigned expected = 2;
+    if (timeout_ms > 0) {
+        queue_link_timeout(&ts, timeout_ms);
+        expected = 3;
+    }
+    if (!submit_and_wait(expected)) {
+        return NET_IO_ERROR;
+    }
+
+    uint64_t tags[3];
+    int results[3];
+    if (!reap(tags, results, expected)) {
+        return NET_IO_ERROR;
+    }
+    int sent = 0;
+    int read_result = 0;
+    bool timed_out = false;
+    for (unsigned i = 0; i < expected; i++) {
+        if (tags[i] == SEND_TAG) sent = results[i];
+        else if (tags[i] == READ_TAG) read_result = results[i];
+        else timed_out = results[i] == -ETIME;
+    }
+
+    if (sent < 0) {
+        if (sent == -EPIPE || sent == -ECONNRESET) {
+            return NET_CONNECTION_CLOSED;
+        }
+        return NET_IO_ERROR;
+    }
+    size_t total = head.size() + body.size();
+    if ((size_t)sent < total) {
+        // Short send broke the link and cancelled the read; finish the usual way
+        std::string_view rest[2];
+        size_t count = 0;
+        if ((size_t)sent < head.size()) {
+            rest[count++] = head.substr(sent);
+            rest[count++] = body;
+        } else {
+            rest[count++] = body.substr(sent - head.size());
+        }
+        NetError error = send_fragments(sockfd, rest, count);
+        if (error != NET_OK) {
+            return error;
+        }
+        read_result = -ECANCELED;
+        timed_out = false;
+    }
+
+    ResponseParser parser;
+    parser.set_body_sink(sink);
+    while (true) {
+        if (read_result == -ECANCELED || read_result == -EINTR) {
+            if (timed_out) {
+                return NET_READ_TIMEOUT;
+            }
+            // Nothing read yet, queue another read
+        } else if (read_result < 0) {
+            return read_result == -ECONNRESET ? NET_CONNECTION_CLOSED : NET_IO_ERROR;
+        } else if (read_result == 0) {
+            parser.finish(); // Completes a body delimited by the connection close
+            if (!parser.done()) {
+                return NET_CONNECTION_CLOSED; // Closed before answering
+            }
+            break;
+        } else {
+            rearm_quickack(sockfd); // As the syscall path does around each read
+            parser.feed(buffer, read_result);
+            if (parser.failed()) {
+                return NET_BAD_RESPONSE; // The connection can't be trusted
+            }
+            if (parser.done()) {
+                break;
+            }
+        }
+
+        int left_ms = remaining_ms(deadline);
+        if (left_ms == 0) {
+            return NET_READ_TIMEOUT;
+        }
+        queue_read(sockfd, READ_TAG, left_ms > 0);
+        expected = 1;
+        if (left_ms > 0) {
+            queue_link_timeout(&ts, left_ms);
+            expected = 2;
+        }
+        if (!submit_and_wait(expected)) {
+            return NET_IO_ERROR;
+        }
+        if (!reap(tags, results, expected)) {
+            return NET_IO_ERROR;
+        }
+        for (unsigned i = 0; i < expected; i++) {
+            if (tags[i] == READ_TAG) read_result = results[i];
+            else timed_out = results[i] == -ETIME;
+        }
+    }
+
+    response = parser.take_response();
+    return NET_OK;
+}
+
+IoUring* thread_io_uring() {
+    // 0 = not tried yet, 1 = usable, -1 = unsupported
+    thread_local int state = 0;
+    thread_local std::unique_ptr<IoUring> ring;
+    if (state == 0) {
+        ring.reset(new IoUring());
+        state = ring->init() ? 1 : -1;
+        if (state < 0) {
+            ring.reset();
+        }
+    }
+    return ring.get();
+}
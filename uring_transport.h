@@ -0,0 +1,69 @@
+#ifndef URING_TRANSPORT_H
+#define URING_TRANSPORT_H
+
+#include <string_view>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include "http_requests.h"
+
+// Size of the receive buffer registered with the kernel
+#define URING_BUFFER_SIZE (64 * 1024)
+
+// Minimal io_uring instance driven through raw syscalls (no liburing).
+// Requests go out as a SENDMSG linked to a READ_FIXED into a registered
+// buffer, so sending a request and waiting for the first bytes of the
+// reply cost one io_uring_enter instead of a write plus a read.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Sets up the rings and registers the receive buffer. Returns false if
+    // the kernel lacks io_uring or one of the operations used here.
+    bool init(unsigned entries = 8);
+
+    // Connects a socket, the same way connect(2) would; with timeout_ms > 0
+    // a linked timeout cancels it (errno ETIMEDOUT) once that much has passed
+    int connect(int sockfd, const struct sockaddr* addr, socklen_t addr_len, int timeout_ms = 0);
+
+    // Same contract as try_send_request. The read timeout is enforced with
+    // linked timeouts; the send itself is bounded by the socket buffer.
+    NetError send_request(int sockfd, std::string_view head, std::string_view body, HttpResponse& response,
+                          const BodySink* sink = nullptr);
+
+private:
+    int ring_fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    struct io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    struct io_uring_cqe* cqes = nullptr;
+
+    char* buffer = nullptr; // Registered as fixed buffer 0
+    unsigned queued = 0;    // SQEs prepared but not submitted yet
+
+    struct io_uring_sqe* next_sqe();
+    void queue_read(int sockfd, uint64_t user_data, bool linked = false);
+    void queue_link_timeout(struct __kernel_timespec* ts, int timeout_ms);
+    bool submit_and_wait(unsigned wait_count);
+    // Takes count completions, waiting for them; false if the ring failed
+    bool reap(uint64_t user_data_out[], int results_out[], unsigned count);
+    bool probe_ops();
+};
+
+// The io_uring of the calling thread, or nullptr if it can't be used
+IoUring* thread_io_uring();
+
+#endif // URING_TRANSPORT_H
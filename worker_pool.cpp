@@ -0,0 +1,81 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(const std::string& host, int port, size_t num_workers)
+    : WorkerPool(std::make_shared<LoadBalancer>(std::vector<Endpoint>{{host, port}}), num_workers) {}
+
+WorkerPool::WorkerPool(std::shared_ptr<LoadBalancer> balancer, size_t num_workers)
+    : balancer(std::move(balancer)), queue(WORKER_QUEUE_SIZE) {
+    if (num_workers == 0) num_workers = 1; // hardware_concurrency() may not know
+    for (size_t i = 0; i < num_workers; i++) {
+        workers.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::push(Job& job) {
+    // Counted before it is visible so that queued never drops below zero.
+    // queued and sleepers are both seq_cst: either the worker sees the new
+    // job before sleeping or we see it asleep and wake it.
+    queued++;
+    while (!queue.try_push(job)) {
+        std::this_thread::yield(); // Full: let the workers catch up
+    }
+    if (sleepers > 0) {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        wakeup.notify_one();
+    }
+}
+
+std::future<HttpResponse> WorkerPool::submit(HttpRequest request) {
+    Job job;
+    job.request = std::move(request);
+    std::future<HttpResponse> result = job.promise.get_future();
+    push(job);
+    return result;
+}
+
+void WorkerPool::submit(HttpRequest request, WorkerCallback callback) {
+    Job job;
+    job.request = std::move(request);
+    job.callback = std::move(callback);
+    push(job);
+}
+
+std::future<HttpResponse> WorkerPool::submit(std::string request_str) {
+    HttpRequest request;
+    request.head = std::move(request_str);
+    return submit(std::move(request));
+}
+
+void WorkerPool::worker_loop() {
+    ConnectionManager connection(balancer); // Owned by this thread only
+    Job job;
+
+    while (true) {
+        if (queue.try_pop(job)) {
+            queued--;
+            HttpResponse response = connection.send(job.request);
+            if (job.callback) job.callback(response);
+            else job.promise.set_value(std::move(response));
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        sleepers++;
+        wakeup.wait(guard, [this] { return queued > 0 || stopping; });
+        sleepers--;
+        if (stopping && queued == 0) break;
+    }
+
+    connection.close();
+}
@@ -0,0 +1,71 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include "http_requests.h"
+#include "connection.h"
+#include "mpmc_queue.h"
+
+// Capacity of the submission queue; submit() waits while it is full
+#define WORKER_QUEUE_SIZE 1024
+
+// Called on the worker thread that got the response
+typedef std::function<void(HttpResponse& response)> WorkerCallback;
+
+// Fixed set of worker threads, each with its own keep-alive connection(s)
+// to the server, fed from a lock-free submission queue. Requests are
+// answered through futures, so independent requests (typically read-only
+// GETs) run in parallel on several cores and sockets.
+class WorkerPool {
+public:
+    WorkerPool(const std::string& host, int port,
+               size_t num_workers = std::thread::hardware_concurrency());
+    // Workers spread their requests over the balancer's endpoints
+    explicit WorkerPool(std::shared_ptr<LoadBalancer> balancer,
+                        size_t num_workers = std::thread::hardware_concurrency());
+    ~WorkerPool(); // Finishes the queued requests, then joins the workers
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queues the request for the next free worker. The future's response has
+    // status_code 0 if no reply could be obtained.
+    std::future<HttpResponse> submit(HttpRequest request);
+    std::future<HttpResponse> submit(std::string request_str);
+
+    // Same, answering through a callback instead of a future
+    void submit(HttpRequest request, WorkerCallback callback);
+
+    size_t size() const { return workers.size(); }
+
+private:
+    struct Job {
+        HttpRequest request;
+        std::promise<HttpResponse> promise;
+        WorkerCallback callback; // Used instead of the promise if set
+    };
+
+    std::shared_ptr<LoadBalancer> balancer; // Shared by all workers
+    MpmcQueue<Job> queue;
+    std::vector<std::thread> workers;
+
+    // Idle workers sleep here; submit() only touches the lock if one does
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> sleepers{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_lock;
+    std::condition_variable wakeup;
+
+    void push(Job& job);
+    void worker_loop();
+};
+
+#endif // WORKER_POOL_H